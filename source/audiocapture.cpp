@@ -0,0 +1,374 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * audiocapture.cpp
+ *
+ * Background WAV capture of the emulated audio
+ *
+ * The emulator only copies samples into a bounded queue of fixed size
+ * blocks; a low priority thread writes them out. When the queue can't hold
+ * a whole frame (the mix and every channel), the frame is dropped from all
+ * streams rather than stalling emulation, and replaced with silence so the
+ * streams stay in sync with each other and with the game.
+ ***************************************************************************/
+
+#include <gccore.h>
+#include <ogcsys.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fileop.h"
+#include "audiocapture.h"
+#include "vba/gba/Sound.h"
+
+#define THREAD_SLEEP 100
+
+#define CAPTURE_STREAMS 7         // mix, 4 APU channels, 2 Direct Sound FIFOs
+#define CAPTURE_BLOCKS 64
+#define CAPTURE_BLOCK_SIZE 4096   // bytes, more than one frame of samples
+
+typedef struct
+{
+	int stream;
+	int length;
+	int silence; // bytes of dropped frames to pad every stream with first
+	u8 data[CAPTURE_BLOCK_SIZE];
+} CaptureBlock;
+
+static const char * streamSuffix[CAPTURE_STREAMS] =
+{ "", "-square1", "-square2", "-wave", "-noise", "-pcma", "-pcmb" };
+
+static lwp_t capturethread = LWP_THREAD_NULL;
+static mutex_t captureLock = LWP_MUTEX_NULL;
+static CaptureBlock * blocks = NULL;
+static int queueHead = 0; // next block to fill
+static int queueTail = 0; // next block to write
+static int queueCount = 0;
+static volatile bool captureActive = false;
+static volatile bool captureStop = false;
+static int captureStreams = 1; // streams written each frame
+static bool frameDropped = false; // the frame being written was dropped
+static int pendingSilence = 0; // dropped bytes not queued as silence yet
+static int droppedFrames = 0;
+static int reportedDrops = 0; // dropped frames of the last capture
+static int captureDevice = -1;
+
+static char capturePath[1024];
+static long captureRate = 0;
+static FILE * captureFile[CAPTURE_STREAMS];
+static u32 captureBytes[CAPTURE_STREAMS];
+
+static void PutLE32(u8 * p, u32 v)
+{
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void PutLE16(u8 * p, u16 v)
+{
+	p[0] = v; p[1] = v >> 8;
+}
+
+/****************************************************************************
+ * WriteWavHeader
+ *
+ * 16-bit stereo PCM header for the given amount of sample data
+ ***************************************************************************/
+static void WriteWavHeader(FILE * f, u32 dataBytes)
+{
+	u8 h[44];
+	memcpy(h, "RIFF", 4);
+	PutLE32(h+4, 36 + dataBytes);
+	memcpy(h+8, "WAVEfmt ", 8);
+	PutLE32(h+16, 16);
+	PutLE16(h+20, 1);              // PCM
+	PutLE16(h+22, 2);              // stereo
+	PutLE32(h+24, captureRate);
+	PutLE32(h+28, captureRate * 4);
+	PutLE16(h+32, 4);
+	PutLE16(h+34, 16);
+	memcpy(h+36, "data", 4);
+	PutLE32(h+40, dataBytes);
+
+	fseek(f, 0, SEEK_SET);
+	fwrite(h, 1, sizeof(h), f);
+	fseek(f, 0, SEEK_END);
+}
+
+static FILE * OpenStream(int stream)
+{
+	if(captureFile[stream])
+		return captureFile[stream];
+
+	char filepath[1024];
+	snprintf(filepath, 1024, "%s%s.wav", capturePath, streamSuffix[stream]);
+	FILE * f = fopen(filepath, "wb");
+
+	if(f)
+		WriteWavHeader(f, 0);
+
+	captureFile[stream] = f;
+	captureBytes[stream] = 0;
+	return f;
+}
+
+static void WriteSilence(int length)
+{
+	static const u8 zero[CAPTURE_BLOCK_SIZE] = { 0 };
+
+	for(int i=0; i < CAPTURE_STREAMS; i++)
+	{
+		if(!captureFile[i])
+			continue;
+
+		for(int left = length; left > 0; left -= CAPTURE_BLOCK_SIZE)
+		{
+			int len = left > CAPTURE_BLOCK_SIZE ? CAPTURE_BLOCK_SIZE : left;
+			captureBytes[i] += fwrite(zero, 1, len, captureFile[i]);
+		}
+	}
+}
+
+static void WriteBlock(CaptureBlock * b)
+{
+	if(b->silence > 0)
+		WriteSilence(b->silence);
+
+	FILE * f = OpenStream(b->stream);
+
+	if(!f)
+		return;
+
+	// samples are native (big endian), WAV is little endian
+	u16 * s = (u16 *)b->data;
+	for(int i = b->length >> 1; i > 0; i--, s++)
+		*s = (*s >> 8) | (*s << 8);
+
+	captureBytes[b->stream] += fwrite(b->data, 1, b->length, f);
+}
+
+/****************************************************************************
+ * capturecallback
+ *
+ * Drains the queue, and on stop finalizes the WAV headers
+ ***************************************************************************/
+static void *
+capturecallback (void *arg)
+{
+	while(1)
+	{
+		CaptureBlock * b = NULL;
+
+		LWP_MutexLock(captureLock);
+		if(queueCount > 0)
+			b = &blocks[queueTail];
+		LWP_MutexUnlock(captureLock);
+
+		if(b)
+		{
+			WriteBlock(b);
+
+			LWP_MutexLock(captureLock);
+			queueTail = (queueTail + 1) % CAPTURE_BLOCKS;
+			queueCount--;
+			LWP_MutexUnlock(captureLock);
+			continue;
+		}
+
+		if(captureStop)
+			break;
+
+		usleep(THREAD_SLEEP);
+	}
+
+	for(int i=0; i < CAPTURE_STREAMS; i++)
+	{
+		if(!captureFile[i])
+			continue;
+		WriteWavHeader(captureFile[i], captureBytes[i]);
+		fclose(captureFile[i]);
+		captureFile[i] = NULL;
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * StartAudioCapture
+ *
+ * Starts writing basepath-NNN.wav (and basepath-NNN-<channel>.wav for each
+ * channel with CAPTURE_CHANNELS), using the first unused NNN
+ ***************************************************************************/
+bool StartAudioCapture(const char * basepath, int mode, long sampleRate)
+{
+	StopAudioCapture();
+
+	if(mode == CAPTURE_OFF)
+		return false;
+
+	blocks = (CaptureBlock *)malloc(sizeof(CaptureBlock) * CAPTURE_BLOCKS);
+
+	if(!blocks)
+		return false;
+
+	if(captureLock == LWP_MUTEX_NULL)
+		LWP_MutexInit(&captureLock, false);
+
+	// never overwrite an earlier capture
+	FILE * f;
+	int n = 0;
+	do
+	{
+		snprintf(capturePath, 1024, "%s-%03d", basepath, ++n);
+		char filepath[1024];
+		snprintf(filepath, 1024, "%s.wav", capturePath);
+		f = fopen(filepath, "rb");
+		if(f)
+			fclose(f);
+	} while(f && n < 999);
+
+	if(!FindDevice(capturePath, &captureDevice))
+		captureDevice = -1;
+
+	captureRate = sampleRate;
+	memset(captureFile, 0, sizeof(captureFile));
+	queueHead = queueTail = queueCount = 0;
+	captureStreams = (mode == CAPTURE_CHANNELS) ? CAPTURE_STREAMS : 1;
+	frameDropped = false;
+	pendingSilence = 0;
+	droppedFrames = 0;
+	captureStop = false;
+
+	if(LWP_CreateThread(&capturethread, capturecallback, NULL, NULL, 0, 30) < 0)
+	{
+		capturethread = LWP_THREAD_NULL;
+		free(blocks);
+		blocks = NULL;
+		return false;
+	}
+
+	// the device stays leased until the capture is stopped
+	if(captureDevice >= 0)
+		AcquireDevice(captureDevice);
+
+	soundSplitChannels = (mode == CAPTURE_CHANNELS);
+	captureActive = true;
+	return true;
+}
+
+/****************************************************************************
+ * StopAudioCapture
+ *
+ * Waits for queued samples to be written and closes the files. The number
+ * of frames that were dropped is kept for AudioCaptureDroppedFrames().
+ ***************************************************************************/
+void StopAudioCapture()
+{
+	if(!captureActive)
+		return;
+
+	captureActive = false;
+	soundSplitChannels = false;
+	captureStop = true;
+
+	if(capturethread != LWP_THREAD_NULL)
+	{
+		LWP_JoinThread(capturethread, NULL);
+		capturethread = LWP_THREAD_NULL;
+	}
+
+	if(captureDevice >= 0)
+		ReleaseDevice(captureDevice);
+
+	free(blocks);
+	blocks = NULL;
+	reportedDrops += droppedFrames;
+}
+
+/****************************************************************************
+ * AudioCaptureDroppedFrames
+ *
+ * Returns the frames replaced with silence since the last call
+ ***************************************************************************/
+int AudioCaptureDroppedFrames()
+{
+	int dropped = reportedDrops;
+	reportedDrops = 0;
+	return dropped;
+}
+
+bool AudioCaptureActive()
+{
+	return captureActive;
+}
+
+/****************************************************************************
+ * AudioCaptureWrite
+ *
+ * Called from the emulator for each buffer of samples. Never blocks on I/O.
+ * stream 0 is the mix, stream n is channel n-1 as numbered by soundSetEnable()
+ * Each frame writes the mix first, then the channels.
+ ***************************************************************************/
+void AudioCaptureWrite(int stream, const u16 * samples, int length)
+{
+	if(!captureActive || stream < 0 || stream >= CAPTURE_STREAMS)
+		return;
+
+	if(stream == 0)
+	{
+		// only take the frame if every stream of it fits, so they stay in step
+		int needed = (length + CAPTURE_BLOCK_SIZE - 1) / CAPTURE_BLOCK_SIZE * captureStreams;
+
+		LWP_MutexLock(captureLock);
+		frameDropped = (CAPTURE_BLOCKS - queueCount < needed);
+		LWP_MutexUnlock(captureLock);
+
+		if(frameDropped)
+		{
+			droppedFrames++;
+			pendingSilence += length;
+			return;
+		}
+	}
+	else if(frameDropped)
+	{
+		return;
+	}
+
+	const u8 * src = (const u8 *)samples;
+
+	while(length > 0)
+	{
+		int len = length > CAPTURE_BLOCK_SIZE ? CAPTURE_BLOCK_SIZE : length;
+		CaptureBlock * b = NULL;
+
+		LWP_MutexLock(captureLock);
+		if(queueCount < CAPTURE_BLOCKS)
+			b = &blocks[queueHead];
+		LWP_MutexUnlock(captureLock);
+
+		if(!b)
+			return; // room was checked for the whole frame, so not expected
+
+		b->stream = stream;
+		b->length = len;
+		b->silence = 0;
+		memcpy(b->data, src, len);
+
+		if(stream == 0 && pendingSilence > 0)
+		{
+			b->silence = pendingSilence;
+			pendingSilence = 0;
+		}
+
+		LWP_MutexLock(captureLock);
+		queueHead = (queueHead + 1) % CAPTURE_BLOCKS;
+		queueCount++;
+		LWP_MutexUnlock(captureLock);
+
+		src += len;
+		length -= len;
+	}
+}
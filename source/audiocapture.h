@@ -0,0 +1,29 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * audiocapture.h
+ *
+ * Background WAV capture of the emulated audio
+ ***************************************************************************/
+
+#ifndef _AUDIOCAPTURE_H_
+#define _AUDIOCAPTURE_H_
+
+#include <gctypes.h>
+
+enum
+{
+	CAPTURE_OFF,
+	CAPTURE_MIX,
+	CAPTURE_CHANNELS // mix, plus each channel in its own file
+};
+
+bool StartAudioCapture(const char * basepath, int mode, long sampleRate);
+void StopAudioCapture();
+int AudioCaptureDroppedFrames();
+bool AudioCaptureActive();
+void AudioCaptureWrite(int stream, const u16 * samples, int length);
+
+#endif
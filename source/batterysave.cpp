@@ -0,0 +1,223 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * batterysave.cpp
+ *
+ * Background battery save writer
+ *
+ * While a game runs, writes to its save memory are noticed through
+ * systemSaveUpdateCounter. Once the game has stopped writing for a moment,
+ * the save memory is copied and a low priority thread writes it to a
+ * temporary file, which then replaces the save file.
+ ***************************************************************************/
+
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "vbagx.h"
+#include "vbasupport.h"
+#include "filebrowser.h"
+#include "fileop.h"
+#include "batterysave.h"
+#include "vba/System.h"
+
+#define THREAD_SLEEP 10000
+#define SAVE_DELAY 2000           // ms since the last write before saving
+#define SAVE_BUFFER_SIZE 0x20100  // largest battery save, plus clock data
+
+static lwp_t saverthread = LWP_THREAD_NULL;
+static u8 * snapshot = NULL;
+static int snapshotSize = 0;
+static volatile bool writePending = false; // snapshot is waiting to be written
+static volatile bool saverStop = false;
+static bool saverActive = false;
+static bool dirty = false;
+static u64 lastWrite = 0;
+static char savePath[MAXPATHLEN];
+static int saveDevice = -1;
+
+/****************************************************************************
+ * WriteSnapshot
+ *
+ * Writes the snapshot next to the save file, then replaces the save file
+ * with it, so an interrupted write never leaves a truncated save
+ ***************************************************************************/
+static void WriteSnapshot()
+{
+	char tmppath[MAXPATHLEN];
+	snprintf(tmppath, MAXPATHLEN, "%s.tmp", savePath);
+
+	FILE * f = fopen(tmppath, "wb");
+
+	if(!f)
+		return;
+
+	size_t written = fwrite(snapshot, 1, snapshotSize, f);
+
+	if(fclose(f) != 0 || written != (size_t)snapshotSize)
+	{
+		remove(tmppath);
+		return;
+	}
+
+	remove(savePath); // rename does not replace an existing file on FAT
+	rename(tmppath, savePath);
+}
+
+static void *
+savercallback (void *arg)
+{
+	while(1)
+	{
+		if(writePending)
+		{
+			WriteSnapshot();
+			writePending = false;
+			continue;
+		}
+
+		if(saverStop)
+			break;
+
+		usleep(THREAD_SLEEP);
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * TakeSnapshot
+ *
+ * Copies the save memory for the writer thread. Must only be called while
+ * the thread is not writing.
+ ***************************************************************************/
+static void TakeSnapshot()
+{
+	int size = SnapshotBatteryFile((char *)snapshot, SAVE_BUFFER_SIZE);
+
+	dirty = false;
+
+	if(size <= 0)
+		return;
+
+	snapshotSize = size;
+	writePending = true;
+}
+
+/****************************************************************************
+ * StartBatterySaver
+ *
+ * Starts saving the battery of the loaded game in the background
+ ***************************************************************************/
+bool StartBatterySaver()
+{
+	StopBatterySaver();
+
+	if(!MakeFilePath(savePath, FILE_SRAM, ROMFilename, 0) ||
+		!FindDevice(savePath, &saveDevice))
+		return false;
+
+	if(!snapshot)
+		snapshot = (u8 *)malloc(SAVE_BUFFER_SIZE);
+
+	if(!snapshot)
+		return false;
+
+	dirty = false;
+	writePending = false;
+	saverStop = false;
+	systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+
+	if(LWP_CreateThread(&saverthread, savercallback, NULL, NULL, 0, 30) < 0)
+	{
+		saverthread = LWP_THREAD_NULL;
+		return false;
+	}
+
+	// the device stays leased while the game runs
+	AcquireDevice(saveDevice);
+	saverActive = true;
+	return true;
+}
+
+/****************************************************************************
+ * StopBatterySaver
+ *
+ * Saves any writes that are still pending and stops the writer thread
+ ***************************************************************************/
+void StopBatterySaver()
+{
+	if(!saverActive)
+		return;
+
+	saverActive = false;
+
+	if(systemSaveUpdateCounter != SYSTEM_SAVE_NOT_UPDATED)
+		dirty = true;
+
+	if(dirty)
+	{
+		while(writePending)
+			usleep(THREAD_SLEEP);
+		TakeSnapshot();
+	}
+
+	saverStop = true;
+	LWP_JoinThread(saverthread, NULL);
+	saverthread = LWP_THREAD_NULL;
+	ReleaseDevice(saveDevice);
+}
+
+/****************************************************************************
+ * UpdateBatterySaver
+ *
+ * Called from the emulation loop. Never waits on I/O.
+ ***************************************************************************/
+void UpdateBatterySaver()
+{
+	if(!saverActive)
+		return;
+
+	u64 now = gettime();
+
+	if(systemSaveUpdateCounter != SYSTEM_SAVE_NOT_UPDATED)
+	{
+		systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+		dirty = true;
+		lastWrite = now;
+		return;
+	}
+
+	if(dirty && !writePending && diff_msec(lastWrite, now) >= SAVE_DELAY)
+		TakeSnapshot();
+}
+
+/****************************************************************************
+ * RecoverBatterySave
+ *
+ * WriteSnapshot only removes the save file once <save>.tmp is complete. If
+ * the save file is missing but the .tmp is there, the write was cut off
+ * before the rename, so the .tmp is moved into place. A .tmp next to an
+ * existing save is from an unfinished write and is removed.
+ ***************************************************************************/
+void RecoverBatterySave(const char * filepath)
+{
+	char tmppath[MAXPATHLEN];
+	struct stat st;
+
+	snprintf(tmppath, MAXPATHLEN, "%s.tmp", filepath);
+
+	if(stat(tmppath, &st) != 0)
+		return;
+
+	if(stat(filepath, &st) == 0)
+		remove(tmppath);
+	else
+		rename(tmppath, filepath);
+}
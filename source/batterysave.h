@@ -0,0 +1,19 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * batterysave.h
+ *
+ * Background battery save writer
+ ***************************************************************************/
+
+#ifndef _BATTERYSAVE_H_
+#define _BATTERYSAVE_H_
+
+bool StartBatterySaver();
+void StopBatterySaver();
+void UpdateBatterySaver();
+void RecoverBatterySave(const char * filepath);
+
+#endif
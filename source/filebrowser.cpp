@@ -546,6 +546,7 @@ int BrowserChangeFolder()
 	{
 		inSz = false;
 		SzClose();
+		SzClearCache();
 	}
 
 	if(!UpdateDirName()) 
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <ogcsys.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -24,6 +25,7 @@
 #include <ogc/dvd.h>
 #include <iso9660.h>
 #include <fat.h>
+#include <ogc/lwp_watchdog.h>
 
 #include "vbagx.h"
 #include "vbasupport.h"
@@ -66,10 +68,33 @@ static bool parseFilter = true;
 static bool ParseDirEntries();
 int selectLoadedFile = 0;
 
+// entries are read in batches that grow from PARSE_BATCH_MIN, so the first
+// page shows quickly but large folders need few merges
+#define PARSE_BATCH_MIN 20
+#define PARSE_BATCH_MAX 128
+static int parseBatch = PARSE_BATCH_MIN;
+static BROWSERENTRY parseSorted[PARSE_BATCH_MAX]; // newest batch, sorted
+
 // device thread
 static lwp_t devicethread = LWP_THREAD_NULL;
 static bool deviceHalt = true;
 
+// mount manager - on the Wii, SD and USB are mounted by the device thread, so
+// a slow drive never stalls the caller for longer than PROBE_TIMEOUT. Code
+// reading or writing a device holds a lease on it instead of halting the
+// device thread, which leaves leased devices alone.
+#define PROBE_TIMEOUT 8000  // ms to wait for a requested mount
+#define PROBE_PROGRESS 500  // ms before showing that a mount is in progress
+#define HOTPLUG_INTERVAL 5  // seconds between mount attempts of absent devices
+
+static mutex_t deviceLock = LWP_MUTEX_NULL; // guards deviceLeases/deviceChecking
+static mutex_t probeLock = LWP_MUTEX_NULL;  // held while mounting
+static int deviceLeases[8];
+static bool deviceChecking[8];
+static volatile bool probePending[8];   // hotplug probe wanted
+static volatile bool probeRequested[8]; // mount asked for by WaitForProbe
+static bool ProbeFAT(int device);
+
 /****************************************************************************
  * ResumeDeviceThread
  *
@@ -114,44 +139,123 @@ HaltParseThread()
 }
 
 
+/****************************************************************************
+ * AcquireDevice
+ *
+ * Takes a lease on the device while a file on it is being accessed. Only
+ * waits for a removal check of the device that is already under way.
+ ***************************************************************************/
+void
+AcquireDevice(int device)
+{
+	LWP_MutexLock(deviceLock);
+	while(deviceChecking[device])
+	{
+		LWP_MutexUnlock(deviceLock);
+		usleep(THREAD_SLEEP);
+		LWP_MutexLock(deviceLock);
+	}
+	deviceLeases[device]++;
+	LWP_MutexUnlock(deviceLock);
+}
+
+void
+ReleaseDevice(int device)
+{
+	LWP_MutexLock(deviceLock);
+	if(deviceLeases[device] > 0)
+		deviceLeases[device]--;
+	LWP_MutexUnlock(deviceLock);
+}
+
+/****************************************************************************
+ * FindFileDevice / AcquireFileDevice / ReleaseFileDevice
+ *
+ * Device leases for files streamed from C code (the Ogg player).
+ * FindFileDevice returns -1 if the path is not on a known device, for which
+ * acquiring and releasing do nothing.
+ ***************************************************************************/
+extern "C" int
+FindFileDevice(const char * filepath)
+{
+	int device;
+
+	if(!FindDevice((char *)filepath, &device))
+		return -1;
+
+	return device;
+}
+
+extern "C" void
+AcquireFileDevice(int device)
+{
+	if(device >= 0)
+		AcquireDevice(device);
+}
+
+extern "C" void
+ReleaseFileDevice(int device)
+{
+	if(device >= 0)
+		ReleaseDevice(device);
+}
+
 /****************************************************************************
  * devicecallback
  *
- * This checks our devices for changes (SD/USB/DVD removed)
+ * This checks our devices for changes (SD/USB/DVD removed), mounts SD and
+ * USB when asked to, and mounts drives that are attached later on
  ***************************************************************************/
 #ifdef HW_RVL
 static int devsleep;
 
+static void
+CheckDevice(int device, const DISC_INTERFACE * disc)
+{
+	if(!isMounted[device])
+		return;
+
+	LWP_MutexLock(deviceLock);
+	if(deviceLeases[device] > 0)
+	{
+		LWP_MutexUnlock(deviceLock);
+		return; // in use, so it's still there
+	}
+	deviceChecking[device] = true;
+	LWP_MutexUnlock(deviceLock);
+
+	if(!disc->isInserted()) // check if the device was removed
+	{
+		unmountRequired[device] = true;
+		isMounted[device] = false;
+	}
+
+	LWP_MutexLock(deviceLock);
+	deviceChecking[device] = false;
+	LWP_MutexUnlock(deviceLock);
+}
+
 static void *
 devicecallback (void *arg)
 {
+	int hotplug = HOTPLUG_INTERVAL;
+
 	while (1)
 	{
-		if(isMounted[DEVICE_SD])
-		{
-			if(!sd->isInserted()) // check if the device was removed
-			{
-				unmountRequired[DEVICE_SD] = true;
-				isMounted[DEVICE_SD] = false;
-			}
-		}
+		CheckDevice(DEVICE_SD, sd);
+		CheckDevice(DEVICE_USB, usb);
+		CheckDevice(DEVICE_DVD, dvd);
 
-		if(isMounted[DEVICE_USB])
+		// a removed device is only mounted again on request, once the
+		// browser is no longer using it
+		if(--hotplug == 0)
 		{
-			if(!usb->isInserted()) // check if the device was removed
-			{
-				unmountRequired[DEVICE_USB] = true;
-				isMounted[DEVICE_USB] = false;
-			}
-		}
+			hotplug = HOTPLUG_INTERVAL;
 
-		if(isMounted[DEVICE_DVD])
-		{
-			if(!dvd->isInserted()) // check if the device was removed
-			{
-				unmountRequired[DEVICE_DVD] = true;
-				isMounted[DEVICE_DVD] = false;
-			}
+			if(!isMounted[DEVICE_SD] && !unmountRequired[DEVICE_SD])
+				probePending[DEVICE_SD] = true;
+			if(!isMounted[DEVICE_USB] && !unmountRequired[DEVICE_USB])
+				probePending[DEVICE_USB] = true;
 		}
 
 		devsleep = 1000*1000; // 1 sec
@@ -160,6 +264,18 @@ devicecallback (void *arg)
 		{
 			if(deviceHalt)
 				LWP_SuspendThread(devicethread);
+
+			// one mount at a time, requested mounts first, so a slow USB
+			// drive probed for hotplug holds up a request by one probe at most
+			if(probeRequested[DEVICE_SD])
+				ProbeFAT(DEVICE_SD);
+			else if(probeRequested[DEVICE_USB])
+				ProbeFAT(DEVICE_USB);
+			else if(probePending[DEVICE_SD])
+				ProbeFAT(DEVICE_SD);
+			else if(probePending[DEVICE_USB])
+				ProbeFAT(DEVICE_USB);
+
 			usleep(THREAD_SLEEP);
 			devsleep -= THREAD_SLEEP;
 		}
@@ -189,6 +305,8 @@ parsecallback (void *arg)
 void
 InitDeviceThread()
 {
+	LWP_MutexInit(&deviceLock, false);
+	LWP_MutexInit(&probeLock, false);
 #ifdef HW_RVL
 	LWP_CreateThread (&devicethread, devicecallback, NULL, NULL, 0, 40);
 #endif
@@ -212,17 +330,14 @@ void UnmountAllFAT()
 }
 
 /****************************************************************************
- * MountFAT
+ * ProbeFAT
  * Checks if the device needs to be (re)mounted
  * If so, unmounts the device
  * Attempts to mount the device specified
- * Sets libfat to use the device by default
  ***************************************************************************/
 
-static bool MountFAT(int device, int silent)
+static bool ProbeFAT(int device)
 {
-	bool mounted = false;
-	int retry = 1;
 	char name[10], name2[10];
 	const DISC_INTERFACE* disc = NULL;
 
@@ -257,9 +372,13 @@ static bool MountFAT(int device, int silent)
 			break;
 #endif
 		default:
+			probePending[device] = false;
+			probeRequested[device] = false;
 			return false; // unknown device
 	}
 
+	LWP_MutexLock(probeLock);
+
 	if(unmountRequired[device])
 	{
 		unmountRequired[device] = false;
@@ -268,10 +387,70 @@ static bool MountFAT(int device, int silent)
 		isMounted[device] = false;
 	}
 
+	if(!isMounted[device])
+		isMounted[device] = disc->startup() && fatMountSimple(name, disc);
+
+	probePending[device] = false;
+	probeRequested[device] = false;
+	LWP_MutexUnlock(probeLock);
+	return isMounted[device];
+}
+
+/****************************************************************************
+ * WaitForProbe
+ * Asks the device thread to mount the device, and waits up to PROBE_TIMEOUT
+ * for it, including any hotplug probe the device thread has to finish first.
+ * A mount that takes longer carries on in the background.
+ ***************************************************************************/
+#ifdef HW_RVL
+static bool WaitForProbe(int device, int silent)
+{
+	u64 start = gettime();
+	bool progress = false;
+
+	probeRequested[device] = true;
+
+	while(probeRequested[device])
+	{
+		if(deviceHalt) // the device thread isn't running - mount it here
+			return ProbeFAT(device);
+
+		u32 elapsed = diff_msec(start, gettime());
+
+		if(elapsed >= PROBE_TIMEOUT)
+			break;
+
+		if(!silent && !progress && elapsed >= PROBE_PROGRESS)
+		{
+			ShowAction("Mounting device...");
+			progress = true;
+		}
+		usleep(THREAD_SLEEP);
+	}
+
+	if(progress)
+		CancelAction();
+	return isMounted[device];
+}
+#endif
+
+/****************************************************************************
+ * MountFAT
+ * Mounts the device specified, prompting to retry on failure
+ ***************************************************************************/
+
+static bool MountFAT(int device, int silent)
+{
+	bool mounted = false;
+	int retry = 1;
+
 	while(retry)
 	{
-		if(disc->startup() && fatMountSimple(name, disc))
-			mounted = true;
+#ifdef HW_RVL
+		mounted = WaitForProbe(device, silent);
+#else
+		mounted = ProbeFAT(device);
+#endif
 
 		if(mounted || silent)
 			break;
@@ -286,15 +465,15 @@ static bool MountFAT(int device, int silent)
 #endif
 	}
 
-	isMounted[device] = mounted;
 	return mounted;
 }
 
 void MountAllFAT()
 {
 #ifdef HW_RVL
-	MountFAT(DEVICE_SD, SILENT);
-	MountFAT(DEVICE_USB, SILENT);
+	ProbeFAT(DEVICE_SD);
+	// USB drives can take a while to spin up - let the device thread mount it
+	probePending[DEVICE_USB] = true;
 #endif
 }
 
@@ -522,6 +701,76 @@ void FindAndSelectLastLoadedFile ()
 	selectLoadedFile = 2; // selecting done
 }
 
+/****************************************************************************
+ * IsValidROMExt
+ *
+ * Extensions of up to 4 characters are packed into one lowercase key, so
+ * each file needs a single switch lookup rather than a chain of strcasecmp
+ ***************************************************************************/
+#define EXTKEY(a,b,c) (((a) << 16) | ((b) << 8) | (c))
+
+static bool IsValidROMExt(const char *ext)
+{
+	u32 key = 0;
+
+	for(int i=0; ext[i] != 0; i++)
+	{
+		if(i == 4)
+			return false;
+		key = (key << 8) | tolower((u8)ext[i]);
+	}
+
+	switch(key)
+	{
+		case EXTKEY('a','g','b'): case EXTKEY('g','b','a'):
+		case EXTKEY('b','i','n'): case EXTKEY('e','l','f'):
+		case EXTKEY(0,'m','b'):   case EXTKEY('d','m','g'):
+		case EXTKEY(0,'g','b'):   case EXTKEY('g','b','c'):
+		case EXTKEY('c','g','b'): case EXTKEY('s','g','b'):
+		case EXTKEY('z','i','p'): case EXTKEY(0,'7','z'):
+			return true;
+	}
+	return false;
+}
+
+static int EntryPtrSortCallback(const void *f1, const void *f2)
+{
+	return FileSortCallback(*(BROWSERENTRY * const *)f1, *(BROWSERENTRY * const *)f2);
+}
+
+/****************************************************************************
+ * MergeNewEntries
+ *
+ * Sorts the count entries following the (already sorted) browser list on
+ * their own, by pointer, then merges them in from the back so that existing
+ * entries are moved at most once
+ ***************************************************************************/
+static void MergeNewEntries(int count)
+{
+	BROWSERENTRY * batch[PARSE_BATCH_MAX];
+	int i;
+
+	for(i=0; i < count; i++)
+		batch[i] = &browserList[browser.numEntries+i];
+
+	qsort(batch, count, sizeof(BROWSERENTRY *), EntryPtrSortCallback);
+
+	for(i=0; i < count; i++)
+		memcpy(&parseSorted[i], batch[i], sizeof(BROWSERENTRY));
+
+	int a = browser.numEntries - 1;
+	int b = count - 1;
+	int d = browser.numEntries + count - 1;
+
+	while(b >= 0)
+	{
+		if(a >= 0 && FileSortCallback(&browserList[a], &parseSorted[b]) > 0)
+			memcpy(&browserList[d--], &browserList[a--], sizeof(BROWSERENTRY));
+		else
+			memcpy(&browserList[d--], &parseSorted[b--], sizeof(BROWSERENTRY));
+	}
+}
+
 static bool ParseDirEntries()
 {
 	if(!dir)
@@ -533,7 +782,7 @@ static bool ParseDirEntries()
 
 	int i = 0;
 
-	while(i < 20 && !parseHalt)
+	while(i < parseBatch && !parseHalt)
 	{
 		entry = readdir(dir);
 
@@ -559,15 +808,7 @@ static bool ParseDirEntries()
 			{
 				ext = GetExt(entry->d_name);
 				
-				if(ext == NULL)
-					continue;
-
-				if(	strcasecmp(ext, "agb") != 0 && strcasecmp(ext, "gba") != 0 &&
-					strcasecmp(ext, "bin") != 0 && strcasecmp(ext, "elf") != 0 &&
-					strcasecmp(ext, "mb") != 0 && strcasecmp(ext, "dmg") != 0 &&
-					strcasecmp(ext, "gb") != 0 && strcasecmp(ext, "gbc") != 0 &&
-					strcasecmp(ext, "cgb") != 0 && strcasecmp(ext, "sgb") != 0 &&
-					strcasecmp(ext, "zip") != 0 && strcasecmp(ext, "7z") != 0)
+				if(ext == NULL || !IsValidROMExt(ext))
 					continue;
 			}
 		}
@@ -598,11 +839,15 @@ static bool ParseDirEntries()
 
 	if(!parseHalt)
 	{
-		// Sort the file list
-		if(i >= 0)
-			qsort(browserList, browser.numEntries+i, sizeof(BROWSERENTRY), FileSortCallback);
-	
+		// Sort the new entries into the file list
+		if(i > 0)
+			MergeNewEntries(i);
+
 		browser.numEntries += i;
+
+		parseBatch <<= 1;
+		if(parseBatch > PARSE_BATCH_MAX)
+			parseBatch = PARSE_BATCH_MAX;
 	}
 
 	if(entry == NULL || parseHalt)
@@ -679,6 +924,7 @@ ParseDirectory(bool waitParse, bool filter)
 	}
 
 	parseHalt = false;
+	parseBatch = PARSE_BATCH_MIN;
 	ParseDirEntries(); // index first 20 entries
 
 	LWP_ResumeThread(parsethread); // index remaining entries
@@ -736,6 +982,10 @@ FreeSaveBuffer ()
 		LWP_MutexUnlock(bufferLock);
 }
 
+static const void * loadedCRCBuffer = NULL; // last file loaded with a known CRC
+static size_t loadedCRCSize = 0;
+static u32 loadedCRC = 0;
+
 /****************************************************************************
  * LoadSzFile
  * Loads the selected file # from the specified 7z into rbuffer
@@ -745,14 +995,21 @@ size_t
 LoadSzFile(char * filepath, unsigned char * rbuffer)
 {
 	size_t size = 0;
+	int device;
+
+	if(!FindDevice(filepath, &device))
+		return 0;
 
-	// stop checking if devices were removed/inserted
-	// since we're loading a file
-	HaltDeviceThread();
+	// keep the device thread off the device while we're loading a file
+	AcquireDevice(device);
 
 	// halt parsing
 	HaltParseThread();
 
+	// rbuffer is about to be overwritten, so any CRC for it is stale
+	loadedCRCBuffer = NULL;
+	loadedCRCSize = 0;
+
 	file = fopen (filepath, "rb");
 	if (file > 0)
 	{
@@ -764,12 +1021,66 @@ LoadSzFile(char * filepath, unsigned char * rbuffer)
 		ErrorPrompt("Error opening file!");
 	}
 
-	// go back to checking if devices were inserted/removed
-	ResumeDeviceThread();
-
+	ReleaseDevice(device);
 	return size;
 }
 
+/****************************************************************************
+ * CRC thread
+ *
+ * Computes the CRC32 of a file while LoadFile is still reading it, trailing
+ * behind the read position. Runs below the main thread's priority, so it
+ * only uses the time spent waiting on the device.
+ ***************************************************************************/
+#define LOADCHUNK (1024*1024)
+
+static lwp_t crcthread = LWP_THREAD_NULL;
+static const u8 * crcBuffer = NULL;
+static volatile size_t crcAvail = 0; // bytes read so far
+static volatile bool crcDone = false; // no more data is coming
+static u32 crcValue = 0;
+
+static void *
+crccallback (void *arg)
+{
+	size_t pos = 0;
+	crcValue = crc32(0L, Z_NULL, 0);
+
+	while(1)
+	{
+		size_t avail = crcAvail;
+
+		if(pos < avail)
+		{
+			crcValue = crc32(crcValue, crcBuffer + pos, avail - pos);
+			pos = avail;
+			continue;
+		}
+
+		if(crcDone)
+			break;
+
+		usleep(THREAD_SLEEP);
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * GetLoadedFileCRC
+ *
+ * Returns the CRC32 of the last uncompressed file read by LoadFile, if it
+ * was read into buffer and was size bytes long
+ ***************************************************************************/
+bool
+GetLoadedFileCRC (const void * buffer, size_t size, u32 * crc)
+{
+	if(loadedCRCBuffer == NULL || buffer != loadedCRCBuffer || size != loadedCRCSize)
+		return false;
+
+	*crc = loadedCRC;
+	return true;
+}
+
 /****************************************************************************
  * LoadFile
  ***************************************************************************/
@@ -784,13 +1095,15 @@ LoadFile (char * rbuffer, char *filepath, size_t length, size_t buffersize, bool
 	if(!FindDevice(filepath, &device))
 		return 0;
 
-	// stop checking if devices were removed/inserted
-	// since we're loading a file
-	HaltDeviceThread();
+	// keep the device thread off the device while we're loading a file
+	AcquireDevice(device);
 
 	// halt parsing
 	HaltParseThread();
 
+	loadedCRCBuffer = NULL;
+	loadedCRCSize = 0;
+
 	// open the file
 	while(retry)
 	{
@@ -838,15 +1151,43 @@ LoadFile (char * rbuffer, char *filepath, size_t length, size_t buffersize, bool
 					size = 0;
 				}
 				else {
-					while(!feof(file))
+					crcBuffer = (u8 *)rbuffer;
+					crcAvail = 0;
+					crcDone = false;
+
+					if(LWP_CreateThread (&crcthread, crccallback, NULL, NULL, 0, 40) < 0)
+						crcthread = LWP_THREAD_NULL;
+
+					while(offset < size)
 					{
 						ShowProgress ("Loading...", offset, size);
-						readsize = fread (rbuffer + offset, 1, 4096, file); // read in next chunk
+						readsize = size - offset;
+						if(readsize > LOADCHUNK)
+							readsize = LOADCHUNK;
+
+						readsize = fread (rbuffer + offset, 1, readsize, file); // read in next chunk
 
 						if(readsize <= 0)
-							break; // reading finished (or failed)
+							break; // reading failed
 
 						offset += readsize;
+						crcAvail = offset;
+					}
+
+					// stop the CRC thread, a short read leaves its result unused
+					crcDone = true;
+
+					if(crcthread != LWP_THREAD_NULL)
+					{
+						LWP_JoinThread(crcthread, NULL);
+						crcthread = LWP_THREAD_NULL;
+
+						if(offset == size)
+						{
+							loadedCRCBuffer = rbuffer;
+							loadedCRCSize = size;
+							loadedCRC = crcValue;
+						}
 					}
 					size = offset;
 					CancelAction();
@@ -857,8 +1198,7 @@ LoadFile (char * rbuffer, char *filepath, size_t length, size_t buffersize, bool
 		fclose (file);
 	}
 
-	// go back to checking if devices were inserted/removed
-	ResumeDeviceThread();
+	ReleaseDevice(device);
 	CancelAction();
 	return size;
 }
@@ -904,33 +1244,23 @@ size_t LoadFont(char * filepath)
 	return loadSize;
 }
 
+/****************************************************************************
+ * LoadBgMusic
+ *
+ * Only checks for a custom track - it is streamed from the device by the Ogg
+ * player rather than loaded into memory
+ ***************************************************************************/
 void LoadBgMusic()
 {
 	char filepath[MAXPATHLEN];
-	sprintf(filepath, "%s/bg_music.ogg", appPath);
-	FILE *file = fopen (filepath, "rb");
-	if(!file) {
-		return;
-	}
-
-	fseeko(file,0,SEEK_END);
-	size_t ogg_size = ftello(file);
+	struct stat st;
 
-	if(ogg_size == 0) {
-		return;
-	}
-
-	u8 * ogg_data = (u8 *)mem2_malloc(ogg_size);
+	sprintf(filepath, "%s/bg_music.ogg", appPath);
 
-	if(!ogg_data) {
+	if(stat(filepath, &st) != 0 || st.st_size == 0)
 		return;
-	}
 
-	fseeko(file, 0, SEEK_SET);
-	fread (ogg_data, 1, ogg_size, file);
-	fclose(file);
-	bg_music = ogg_data;
-	bg_music_size = ogg_size;
+	snprintf(bg_music_file, MAXPATHLEN, "%s", filepath);
 }
 #endif
 
@@ -952,9 +1282,8 @@ SaveFile (char * buffer, char *filepath, size_t datasize, bool silent)
 	if(datasize == 0)
 		return 0;
 
-	// stop checking if devices were removed/inserted
-	// since we're saving a file
-	HaltDeviceThread();
+	// keep the device thread off the device while we're saving a file
+	AcquireDevice(device);
 
 	// halt parsing
 	HaltParseThread();
@@ -998,8 +1327,7 @@ SaveFile (char * buffer, char *filepath, size_t datasize, bool silent)
 		}
 	}
 
-	// go back to checking if devices were inserted/removed
-	ResumeDeviceThread();
+	ReleaseDevice(device);
 	if(!silent)
 		CancelAction();
 	return written;
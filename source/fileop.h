@@ -21,6 +21,11 @@ void InitDeviceThread();
 void ResumeDeviceThread();
 void HaltDeviceThread();
 void HaltParseThread();
+void AcquireDevice(int device);
+void ReleaseDevice(int device);
+extern "C" int FindFileDevice(const char * filepath);
+extern "C" void AcquireFileDevice(int device);
+extern "C" void ReleaseFileDevice(int device);
 void MountAllFAT();
 void UnmountAllFAT();
 bool FindDevice(char * filepath, int * device);
@@ -35,6 +40,7 @@ void AllocSaveBuffer();
 void FreeSaveBuffer();
 size_t LoadFile(char * rbuffer, char *filepath, size_t length, size_t buffersize, bool silent);
 size_t LoadFile(char * filepath, bool silent);
+bool GetLoadedFileCRC(const void * buffer, size_t size, u32 * crc);
 size_t LoadSzFile(char * filepath, unsigned char * rbuffer);
 size_t LoadFont(char *filepath);
 void LoadBgMusic();
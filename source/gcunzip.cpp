@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
+#include <unistd.h>
 #include <zlib.h>
 #include <sys/stat.h>
 
@@ -20,60 +22,47 @@
 #include "filebrowser.h"
 #include "menu.h"
 #include "gcunzip.h"
+#include "vba/Util.h"
 
 extern "C" {
 #include "utils/sz/7zCrc.h"
 #include "utils/sz/7zIn.h"
 #include "utils/sz/7zExtract.h"
+#include "utils/sz/7zDecode.h"
 }
 
-#define ZIPCHUNK 2048
+#define ZIPCHUNK (256*1024)     // compressed data is read in chunks of this size
+#define ZIPPROGRESS (1024*1024) // progress is updated every this many bytes
+#define ZIPHEADCHUNK 4096       // ReadZipHead reads this much at a time
+#define ZIP_EOCD_SEARCH (22+65535) // end record plus the longest comment
+#define ZIP_MAX_CENTRAL_DIR (1024*1024)
+#define THREAD_SLEEP 100
 
 /*
- * Zip file header definition
+ * Zip archive member, from the central directory
  */
 typedef struct
 {
-  unsigned int zipid __attribute__ ((__packed__));	// 0x04034b50
-  unsigned short zipversion __attribute__ ((__packed__));
-  unsigned short zipflags __attribute__ ((__packed__));
-  unsigned short compressionMethod __attribute__ ((__packed__));
-  unsigned short lastmodtime __attribute__ ((__packed__));
-  unsigned short lastmoddate __attribute__ ((__packed__));
-  unsigned int crc32 __attribute__ ((__packed__));
-  unsigned int compressedSize __attribute__ ((__packed__));
-  unsigned int uncompressedSize __attribute__ ((__packed__));
-  unsigned short filenameLength __attribute__ ((__packed__));
-  unsigned short extraDataLength __attribute__ ((__packed__));
+	u32 offset; // offset of the member's local header
+	u32 compressedSize;
+	u32 uncompressedSize; // 0 if unknown
+	u16 method;
 }
-PKZIPHEADER;
+ZIPMEMBER;
 
 /*
  * Zip files are stored little endian
- * Support functions for short and int types
  */
-static u32
-FLIP32 (u32 b)
+static u16
+GetLE16 (const u8 * p)
 {
-	unsigned int c;
-
-	c = (b & 0xff000000) >> 24;
-	c |= (b & 0xff0000) >> 8;
-	c |= (b & 0xff00) << 8;
-	c |= (b & 0xff) << 24;
-
-	return c;
+	return p[0] | (p[1] << 8);
 }
 
-static u16
-FLIP16 (u16 b)
+static u32
+GetLE32 (const u8 * p)
 {
-	u16 c;
-
-	c = (b & 0xff00) >> 8;
-	c |= (b & 0xff) << 8;
-
-	return c;
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
 }
 
 /****************************************************************************
@@ -92,144 +81,391 @@ IsZipFile (char *buffer)
 	return 0;
 }
 
-/*****************************************************************************
-* UnZipBuffer
-******************************************************************************/
+static bool
+IsRomName (const char * name)
+{
+	return utilIsGBAImage(name) || utilIsGBImage(name);
+}
 
-size_t
-UnZipBuffer (unsigned char *outbuffer, size_t buffersize)
+/****************************************************************************
+ * FindZipMember
+ *
+ * Finds the member to load from the central directory: the first one with
+ * a GB/GBA extension, otherwise the first one. If the archive has no
+ * readable central directory, falls back to the first local header.
+ ***************************************************************************/
+static bool
+FindZipMember (FILE * fp, ZIPMEMBER * member, char * name, int namesize)
 {
-	PKZIPHEADER pkzip;
-	size_t zipoffset = 0;
-	size_t zipchunk = 0;
-	char out[ZIPCHUNK];
-	z_stream zs;
-	int res;
-	size_t bufferoffset = 0;
-	size_t have = 0;
-	char readbuffer[ZIPCHUNK];
-	size_t sizeread = 0;
+	u8 * buf;
+	u8 header[30];
+	int eocd = -1;
+	bool found = false;
 
-	// Read Zip Header
-	fseek(file, 0, SEEK_SET);
-	sizeread = fread (readbuffer, 1, ZIPCHUNK, file);
+	if(fseeko(fp, 0, SEEK_END) != 0)
+		return false;
 
-	if(sizeread <= 0)
-		return 0;
+	off_t filesize = ftello(fp);
+	size_t tail = filesize < ZIP_EOCD_SEARCH ? filesize : ZIP_EOCD_SEARCH;
 
-	/*** Copy PKZip header to local, used as info ***/
-	memcpy (&pkzip, readbuffer, sizeof (PKZIPHEADER));
+	// the end of central directory record is followed only by the comment
+	buf = (u8 *)malloc(tail);
 
-	pkzip.uncompressedSize = FLIP32 (pkzip.uncompressedSize);
+	if(buf && tail >= 22 && fseeko(fp, filesize - tail, SEEK_SET) == 0 &&
+		fread(buf, 1, tail, fp) == tail)
+	{
+		for(int p = tail - 22; p >= 0; p--)
+		{
+			if(GetLE32(&buf[p]) == 0x06054b50)
+			{
+				eocd = p;
+				break;
+			}
+		}
+	}
 
-	if(pkzip.uncompressedSize > buffersize) {
-		return 0;
+	if(eocd >= 0)
+	{
+		int entries = GetLE16(&buf[eocd+10]);
+		u32 cdsize = GetLE32(&buf[eocd+12]);
+		u32 cdoffset = GetLE32(&buf[eocd+16]);
+		free(buf);
+		buf = NULL;
+
+		if(cdsize <= ZIP_MAX_CENTRAL_DIR && cdoffset + cdsize <= filesize)
+			buf = (u8 *)malloc(cdsize);
+
+		if(buf && fseeko(fp, cdoffset, SEEK_SET) == 0 &&
+			fread(buf, 1, cdsize, fp) == cdsize)
+		{
+			char entryname[256];
+			u32 p = 0;
+
+			for(int i=0; i < entries && p + 46 <= cdsize; i++)
+			{
+				if(GetLE32(&buf[p]) != 0x02014b50)
+					break;
+
+				int namelen = GetLE16(&buf[p+28]);
+				u32 next = p + 46 + namelen + GetLE16(&buf[p+30]) + GetLE16(&buf[p+32]);
+
+				if(next > cdsize)
+					break;
+
+				int len = namelen < 255 ? namelen : 255;
+				memcpy(entryname, &buf[p+46], len);
+				entryname[len] = 0;
+
+				if(!found || IsRomName(entryname))
+				{
+					member->method = GetLE16(&buf[p+10]);
+					member->compressedSize = GetLE32(&buf[p+20]);
+					member->uncompressedSize = GetLE32(&buf[p+24]);
+					member->offset = GetLE32(&buf[p+42]);
+
+					if(name)
+						snprintf(name, namesize, "%s", entryname);
+
+					if(found)
+						break; // a ROM, after some other first member
+
+					found = true;
+
+					if(IsRomName(entryname))
+						break;
+				}
+				p = next;
+			}
+		}
 	}
 
-	ShowProgress ("Loading...", 0, pkzip.uncompressedSize);
+	free(buf);
+
+	if(found)
+		return true;
+
+	// no central directory - use the first local header
+	if(fseeko(fp, 0, SEEK_SET) != 0 || fread(header, 1, 30, fp) != 30 ||
+		GetLE32(header) != 0x04034b50)
+		return false;
+
+	int namelen = GetLE16(&header[26]);
+	u32 dataoffset = 30 + namelen + GetLE16(&header[28]);
+
+	member->offset = 0;
+	member->method = GetLE16(&header[8]);
+	member->compressedSize = GetLE32(&header[18]);
+	member->uncompressedSize = GetLE32(&header[22]);
+
+	if(GetLE16(&header[6]) & 0x08) // sizes follow the data
+	{
+		member->compressedSize = filesize - dataoffset;
+		member->uncompressedSize = 0;
+	}
+
+	if(name)
+	{
+		int len = namelen < namesize - 1 ? namelen : namesize - 1;
+		len = fread(name, 1, len, fp);
+		name[len] = 0;
+	}
+	return true;
+}
+
+/****************************************************************************
+ * Zip read thread
+ *
+ * Reads the compressed data into two alternating buffers, so that the next
+ * chunk is being read while the previous one is inflated
+ ***************************************************************************/
+static lwp_t zipthread = LWP_THREAD_NULL;
+static u8 * zipbuf[2] = { NULL, NULL };
+static volatile size_t zipbuflen[2];
+static volatile bool zipbufready[2];
+static volatile bool zipabort = false;
+static size_t zipremaining = 0;
+
+static void *
+zipreadcallback (void *arg)
+{
+	int i = 0;
+
+	while(zipremaining > 0 && !zipabort)
+	{
+		if(zipbufready[i])
+		{
+			usleep(THREAD_SLEEP);
+			continue;
+		}
+
+		size_t len = zipremaining > ZIPCHUNK ? ZIPCHUNK : zipremaining;
+		len = fread(zipbuf[i], 1, len, file);
+		zipbuflen[i] = len;
+		zipbufready[i] = true;
+
+		if(len == 0)
+			break; // read failure - an empty buffer tells the inflater
+
+		zipremaining -= len;
+		i ^= 1;
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * InflateMember
+ *
+ * Inflates compressedSize bytes from the current file position straight
+ * into outbuffer. Returns the uncompressed size, or 0 on failure.
+ ***************************************************************************/
+static size_t
+InflateMember (unsigned char *outbuffer, size_t buffersize, size_t compressedSize, size_t total)
+{
+	z_stream zs;
+	int res = Z_DATA_ERROR;
+	size_t consumed = 0;
+	size_t nextProgress = ZIPPROGRESS;
+	int i = 0;
+
+	zipbuf[0] = (u8 *)memalign(32, ZIPCHUNK);
+	zipbuf[1] = (u8 *)memalign(32, ZIPCHUNK);
+
+	if(!zipbuf[0] || !zipbuf[1])
+		goto done;
 
-	/*** Prepare the zip stream ***/
 	memset (&zs, 0, sizeof (z_stream));
-	zs.zalloc = Z_NULL;
-	zs.zfree = Z_NULL;
-	zs.opaque = Z_NULL;
-	zs.avail_in = 0;
-	zs.next_in = Z_NULL;
-	res = inflateInit2 (&zs, -MAX_WBITS);
-
-	if (res != Z_OK)
+	zs.next_out = outbuffer;
+	zs.avail_out = buffersize;
+
+	if (inflateInit2 (&zs, -MAX_WBITS) != Z_OK)
 		goto done;
 
-	/*** Set ZipChunk for first pass ***/
-	zipoffset =
-	(sizeof (PKZIPHEADER) + FLIP16 (pkzip.filenameLength) +
-	FLIP16 (pkzip.extraDataLength));
-	zipchunk = ZIPCHUNK - zipoffset;
+	zipbufready[0] = zipbufready[1] = false;
+	zipremaining = compressedSize;
+	zipabort = false;
 
-	/*** Now do it! ***/
-	do
+	if(LWP_CreateThread (&zipthread, zipreadcallback, NULL, NULL, 0, 70) < 0)
 	{
-		zs.avail_in = zipchunk;
-		zs.next_in = (Bytef *) & readbuffer[zipoffset];
+		zipthread = LWP_THREAD_NULL;
+		inflateEnd (&zs);
+		goto done;
+	}
 
-		/*** Now inflate until input buffer is exhausted ***/
-		do
-		{
-			zs.avail_out = ZIPCHUNK;
-			zs.next_out = (Bytef *) & out;
+	while(consumed < compressedSize)
+	{
+		while(!zipbufready[i])
+			usleep(THREAD_SLEEP);
 
-			res = inflate (&zs, Z_NO_FLUSH);
+		size_t len = zipbuflen[i];
 
-			if (res == Z_MEM_ERROR)
-			{
-				goto done;
-			}
+		if(len == 0)
+			break; // read failure
 
-			have = ZIPCHUNK - zs.avail_out;
-			if (have)
-			{
-				/*** Copy to normal block buffer ***/
-				memcpy (&outbuffer[bufferoffset], &out, have);
-				bufferoffset += have;
-			}
-		}
-		while (zs.avail_out == 0);
+		zs.next_in = zipbuf[i];
+		zs.avail_in = len;
+		res = inflate (&zs, Z_NO_FLUSH);
 
-		// Readup the next 2k block
-		zipoffset = 0;
-		zipchunk = ZIPCHUNK;
+		zipbufready[i] = false;
+		i ^= 1;
+		consumed += len;
 
-		sizeread = fread (readbuffer, 1, ZIPCHUNK, file);
-		if(sizeread <= 0)
-			goto done; // read failure
+		if(res != Z_OK)
+			break;
 
-		ShowProgress ("Loading...", bufferoffset, pkzip.uncompressedSize);
+		if(zs.total_out >= nextProgress)
+		{
+			ShowProgress ("Loading...", zs.total_out, total);
+			nextProgress = zs.total_out + ZIPPROGRESS;
+		}
 	}
-	while (res != Z_STREAM_END);
 
-done:
+	zipabort = true;
+	LWP_JoinThread(zipthread, NULL);
+	zipthread = LWP_THREAD_NULL;
 	inflateEnd (&zs);
-	CancelAction();
+
+done:
+	free(zipbuf[0]);
+	free(zipbuf[1]);
+	zipbuf[0] = zipbuf[1] = NULL;
 
 	if (res == Z_STREAM_END)
-		return pkzip.uncompressedSize;
+		return zs.total_out;
 	else
 		return 0;
 }
 
+/*****************************************************************************
+* UnZipBuffer
+*
+* Unzips the ROM member of the open zip file straight into outbuffer
+******************************************************************************/
+
+size_t
+UnZipBuffer (unsigned char *outbuffer, size_t buffersize)
+{
+	ZIPMEMBER member;
+	u8 header[30];
+	size_t size = 0;
+
+	if(!FindZipMember(file, &member, NULL, 0))
+		return 0;
+
+	if(member.uncompressedSize > buffersize)
+		return 0;
+
+	// the local header's name and extra field lengths may differ from the
+	// central directory's
+	if(fseeko(file, member.offset, SEEK_SET) != 0 ||
+		fread(header, 1, 30, file) != 30 || GetLE32(header) != 0x04034b50 ||
+		fseeko(file, member.offset + 30 + GetLE16(&header[26]) +
+			GetLE16(&header[28]), SEEK_SET) != 0)
+		return 0;
+
+	size_t total = member.uncompressedSize ? member.uncompressedSize : buffersize;
+
+	ShowProgress ("Loading...", 0, total);
+
+	if(member.method == 0) // stored
+	{
+		// a stored member is its own size, whatever uncompressedSize says
+		if(member.compressedSize > buffersize)
+		{
+			CancelAction();
+			return 0;
+		}
+
+		while(size < member.compressedSize)
+		{
+			size_t len = member.compressedSize - size;
+			if(len > ZIPCHUNK)
+				len = ZIPCHUNK;
+
+			len = fread (outbuffer + size, 1, len, file);
+
+			if(len == 0)
+				break;
+
+			size += len;
+			ShowProgress ("Loading...", size, total);
+		}
+
+		if(size != member.compressedSize)
+			size = 0;
+	}
+	else if(member.method == 8) // deflate
+	{
+		size = InflateMember(outbuffer, buffersize, member.compressedSize, total);
+	}
+
+	CancelAction();
+	return size;
+}
+
 /****************************************************************************
-* GetFirstZipFilename
+* ReadZipHead
 *
-* Returns the filename of the first file in the zipped archive
-* The idea here is to do the least amount of work required
+* Reads up to length bytes from the start of the member UnZipBuffer would
+* load, and its name. Only the central directory and as much compressed data
+* as needed are read. Returns the number of bytes read.
 ***************************************************************************/
 
-char *
-GetFirstZipFilename ()
+size_t
+ReadZipHead (FILE * fp, unsigned char *buffer, size_t length, char * name, int namesize)
 {
-	char * firstFilename = NULL;
-	char tempbuffer[ZIPCHUNK];
-	char filepath[1024];
+	ZIPMEMBER member;
+	u8 header[30];
+	u8 in[ZIPHEADCHUNK];
+	z_stream zs;
+	int res = Z_OK;
 
-	if(!MakeFilePath(filepath, FILE_ROM))
-		return NULL;
+	if(!FindZipMember(fp, &member, name, namesize))
+		return 0;
+
+	if(fseeko(fp, member.offset, SEEK_SET) != 0 ||
+		fread(header, 1, 30, fp) != 30 || GetLE32(header) != 0x04034b50 ||
+		fseeko(fp, member.offset + 30 + GetLE16(&header[26]) +
+			GetLE16(&header[28]), SEEK_SET) != 0)
+		return 0;
+
+	if(member.method == 0) // stored
+	{
+		if(length > member.compressedSize)
+			length = member.compressedSize;
+		return fread(buffer, 1, length, fp);
+	}
 
-	// read start of ZIP
-	if(LoadFile (tempbuffer, filepath, ZIPCHUNK, ZIPCHUNK, NOTSILENT) < 35)
-		return NULL;
+	if(member.method != 8)
+		return 0;
 
-	tempbuffer[28] = 0; // truncate - filename length is 2 bytes long (bytes 26-27)
-	int namelength = tempbuffer[26]; // filename length starts 26 bytes in
+	memset (&zs, 0, sizeof (z_stream));
+	zs.next_out = buffer;
+	zs.avail_out = length;
+
+	if (inflateInit2 (&zs, -MAX_WBITS) != Z_OK)
+		return 0;
 
-	if(namelength < 0 || namelength > 200) // filename is not a reasonable length
+	size_t remaining = member.compressedSize;
+
+	while(zs.avail_out > 0 && res == Z_OK)
 	{
-		ErrorPrompt("Error - Invalid ZIP file!");
-		return NULL;
+		if(zs.avail_in == 0)
+		{
+			size_t len = remaining < ZIPHEADCHUNK ? remaining : ZIPHEADCHUNK;
+
+			if(len == 0 || (len = fread(in, 1, len, fp)) == 0)
+				break;
+
+			remaining -= len;
+			zs.next_in = in;
+			zs.avail_in = len;
+		}
+		res = inflate (&zs, Z_NO_FLUSH);
 	}
-	
-	firstFilename = &tempbuffer[30]; // first filename of a ZIP starts 31 bytes in
-	firstFilename[namelength] = 0; // truncate at filename length
-	return strdup(firstFilename);
+
+	length -= zs.avail_out;
+	inflateEnd (&zs);
+	return length;
 }
 
 /****************************************************************************
@@ -267,9 +503,16 @@ static size_t SzOffset;
 static size_t SzOutSizeProcessed;
 static CFileItem *SzF;
 
-static char sz_buffer[2048];
+#define SZ_READ_SIZE (64*1024)
+
+static char sz_buffer[SZ_READ_SIZE];
 static int szMethod = 0;
 
+// archive the 7z decoder cache belongs to
+static char szCachePath[MAXPATHLEN] = { 0 };
+static time_t szCacheTime = 0;
+static off_t szCacheSize = 0;
+
 /****************************************************************************
 * Is7ZipFile
 *
@@ -308,8 +551,8 @@ static SZ_RESULT SzFileReadImp(void *object, void **buffer, size_t maxRequiredSi
 	// the void* object is a SzFileInStream
 	SzFileInStream *s = (SzFileInStream *) object;
 
-	if (maxRequiredSize > 2048)
-		maxRequiredSize = 2048;
+	if (maxRequiredSize > SZ_READ_SIZE)
+		maxRequiredSize = SZ_READ_SIZE;
 
 	// read data
 	sizeread = fread(sz_buffer, 1, maxRequiredSize, file);
@@ -358,6 +601,18 @@ void SzClose()
 		SzArDbExFree(&SzDb, SzAllocImp.Free);
 }
 
+/****************************************************************************
+* SzClearCache
+*
+* Frees the decoder kept from the last extraction
+***************************************************************************/
+
+void SzClearCache()
+{
+	SzDecodeCacheFree();
+	szCachePath[0] = 0;
+}
+
 /****************************************************************************
 * SzParse
 *
@@ -380,6 +635,17 @@ int SzParse(char * filepath)
 	if(!FindDevice(filepath, &device) || !filelen)
 		return 0;
 
+	// a decoder kept from another archive (or an older copy of this one)
+	// must not be resumed
+	if(strcmp(szCachePath, filepath) != 0 || szCacheTime != filestat.st_mtime ||
+		szCacheSize != filestat.st_size)
+	{
+		SzClearCache();
+		snprintf(szCachePath, MAXPATHLEN, "%s", filepath);
+		szCacheTime = filestat.st_mtime;
+		szCacheSize = filestat.st_size;
+	}
+
 	int nbfiles = 0;
 	// setup archive stream
 	SzArchiveStream.offset = 0;
@@ -10,11 +10,14 @@
 #ifndef _GCUNZIP_H_
 #define _GCUNZIP_H_
 
+#include <stdio.h>
+
 int IsZipFile (char *buffer);
-char * GetFirstZipFilename();
+size_t ReadZipHead (FILE * fp, unsigned char *buffer, size_t length, char * name, int namesize);
 size_t UnZipBuffer (unsigned char *outbuffer, size_t buffersize);
 int SzParse(char * filepath);
 size_t SzExtractFile(int i, unsigned char *buffer);
 void SzClose();
+void SzClearCache();
 
 #endif
@@ -87,7 +87,8 @@ enum
 enum
 {
 	SOUND_PCM,
-	SOUND_OGG
+	SOUND_OGG,
+	SOUND_OGG_FILE
 };
 
 enum
@@ -148,9 +149,9 @@ class GuiSound
 {
 	public:
 		//!Constructor
-		//!\param s Pointer to the sound data
+		//!\param s Pointer to the sound data (file path for SOUND_OGG_FILE)
 		//!\param l Length of sound data
-		//!\param t Sound format type (SOUND_PCM or SOUND_OGG)
+		//!\param t Sound format type (SOUND_PCM, SOUND_OGG or SOUND_OGG_FILE)
 		GuiSound(const u8 * s, s32 l, int t);
 		//!Destructor
 		~GuiSound();
@@ -173,7 +174,7 @@ class GuiSound
 		void SetLoop(bool l);
 	protected:
 		const u8 * sound; //!< Pointer to the sound data
-		int type; //!< Sound format type (SOUND_PCM or SOUND_OGG)
+		int type; //!< Sound format type (SOUND_PCM, SOUND_OGG or SOUND_OGG_FILE)
 		s32 length; //!< Length of sound data
 		s32 voice; //!< Currently assigned ASND voice channel
 		s32 volume; //!< Sound volume (0-100)
@@ -434,6 +435,13 @@ class GuiElement
 		virtual void Draw();
 		//!Called constantly to redraw the element's tooltip
 		virtual void DrawTooltip();
+		//!Marks the screen as changed, so that the next GUI frame is drawn
+		static void Invalidate();
+		//!Checks whether anything on screen changed since Validate() was last called
+		//!\return true if the GUI needs to be drawn
+		static bool IsInvalidated();
+		//!Marks the screen as up to date, before drawing it
+		static void Validate();
 	protected:
 		GuiTrigger * trigger[3]; //!< GuiTriggers (input actions) that this element responds to
 		UpdateCallback updateCB; //!< Callback function to call when this element is updated
@@ -706,10 +714,16 @@ class GuiText : public GuiElement
 		//!Constantly called to draw the text
 		void Draw();
 	protected:
+		//!Discards the laid out text lines, so they are rebuilt on the next draw
+		void ClearLayout();
+		//!Lays out the text lines for the current font size and maximum width
+		void UpdateLayout();
 		GXColor color; //!< Font color
 		wchar_t* text; //!< Translated Unicode text value
 		wchar_t *textDyn[20]; //!< Text value, if max width, scrolling, or wrapping enabled
 		int textDynNum; //!< Number of text lines
+		int *textWidths; //!< Width of each leading substring of text, at the font size of the layout
+		int textLayoutSize; //!< Font size the text lines were laid out for
 		char * origText; //!< Original text data (English)
 		int size; //!< Font size
 		int maxWidth; //!< Maximum width of the generated text object (for text wrapping)
@@ -950,7 +964,9 @@ class GuiOptionBrowser : public GuiElement
 typedef struct _savelist {
 	int length;
 	char filename[MAX_SAVES+1][256];
-	GuiImageData * previewImg[MAX_SAVES+1];
+	u8 * previewImg[MAX_SAVES+1]; // held from the image cache
+	int previewWidth[MAX_SAVES+1];
+	int previewHeight[MAX_SAVES+1];
 	char date[MAX_SAVES+1][20];
 	char time[MAX_SAVES+1][10];
 	int type[MAX_SAVES+1];
@@ -10,6 +10,23 @@
 
 #include "gui.h"
 
+static volatile bool invalidated = true; // the screen needs to be drawn
+
+void GuiElement::Invalidate()
+{
+	invalidated = true;
+}
+
+bool GuiElement::IsInvalidated()
+{
+	return invalidated;
+}
+
+void GuiElement::Validate()
+{
+	invalidated = false;
+}
+
 /**
  * Constructor for the Object class.
  */
@@ -65,6 +82,7 @@ GuiElement::~GuiElement()
 void GuiElement::SetParent(GuiElement * e)
 {
 	parentElement = e;
+	Invalidate();
 }
 
 GuiElement * GuiElement::GetParent()
@@ -189,6 +207,7 @@ void GuiElement::SetSize(int w, int h)
 
 	width = w;
 	height = h;
+	Invalidate();
 }
 
 bool GuiElement::IsVisible()
@@ -198,11 +217,17 @@ bool GuiElement::IsVisible()
 
 void GuiElement::SetVisible(bool v)
 {
+	if(visible != v)
+		Invalidate();
+
 	visible = v;
 }
 
 void GuiElement::SetAlpha(int a)
 {
+	if(alpha != a)
+		Invalidate();
+
 	alpha = a;
 }
 
@@ -223,16 +248,19 @@ void GuiElement::SetScale(float s)
 {
 	xscale = s;
 	yscale = s;
+	Invalidate();
 }
 
 void GuiElement::SetScaleX(float s)
 {
 	xscale = s;
+	Invalidate();
 }
 
 void GuiElement::SetScaleY(float s)
 {
 	yscale = s;
+	Invalidate();
 }
 
 void GuiElement::SetScale(int mw, int mh)
@@ -246,6 +274,7 @@ void GuiElement::SetScale(int mw, int mh)
 			xscale = mh/(height*1.0);
 	}
 	yscale = xscale;
+	Invalidate();
 }
 
 float GuiElement::GetScale()
@@ -290,6 +319,9 @@ int GuiElement::GetStateChan()
 
 void GuiElement::SetState(int s, int c)
 {
+	if(state != s)
+		Invalidate();
+
 	state = s;
 	stateChan = c;
 }
@@ -298,6 +330,9 @@ void GuiElement::ResetState()
 {
 	if(state != STATE_DISABLED)
 	{
+		if(state != STATE_DEFAULT)
+			Invalidate();
+
 		state = STATE_DEFAULT;
 		stateChan = -1;
 	}
@@ -411,6 +446,7 @@ void GuiElement::SetEffect(int eff, int amount, int target)
 	effects |= eff;
 	effectAmount = amount;
 	effectTarget = target;
+	Invalidate();
 }
 
 void GuiElement::SetEffectOnOver(int eff, int amount, int target)
@@ -427,6 +463,9 @@ void GuiElement::SetEffectGrow()
 
 void GuiElement::UpdateEffects()
 {
+	if(effects)
+		Invalidate(); // keep drawing until the effect is over
+
 	if(effects & (EFFECT_SLIDE_IN | EFFECT_SLIDE_OUT))
 	{
 		if(effects & EFFECT_SLIDE_IN)
@@ -546,6 +585,9 @@ void GuiElement::SetUpdateCallback(UpdateCallback u)
 
 void GuiElement::SetPosition(int xoff, int yoff)
 {
+	if(xoffset != xoff || yoffset != yoff)
+		Invalidate();
+
 	xoffset = xoff;
 	yoffset = yoff;
 }
@@ -554,6 +596,7 @@ void GuiElement::SetAlignment(int hor, int vert)
 {
 	alignmentHor = hor;
 	alignmentVert = vert;
+	Invalidate();
 }
 
 int GuiElement::GetSelected()
@@ -94,6 +94,10 @@ u8 * GuiImage::GetImage()
 
 void GuiImage::SetImage(GuiImageData * img)
 {
+	if(imgType == IMAGE_DATA && img && image == img->GetImage() &&
+		width == img->GetWidth() && height == img->GetHeight())
+		return; // unchanged, so no redraw
+
 	image = NULL;
 	width = 0;
 	height = 0;
@@ -104,23 +108,34 @@ void GuiImage::SetImage(GuiImageData * img)
 		height = img->GetHeight();
 	}
 	imgType = IMAGE_DATA;
+	Invalidate();
 }
 
 void GuiImage::SetImage(u8 * img, int w, int h)
 {
+	if(imgType == IMAGE_TEXTURE && image == img && width == w && height == h)
+		return; // unchanged, so no redraw
+
 	image = img;
 	width = w;
 	height = h;
 	imgType = IMAGE_TEXTURE;
+	Invalidate();
 }
 
 void GuiImage::SetAngle(float a)
 {
+	if(imageangle != a)
+		Invalidate();
+
 	imageangle = a;
 }
 
 void GuiImage::SetTile(int t)
 {
+	if(tile != t)
+		Invalidate();
+
 	tile = t;
 }
 
@@ -148,11 +163,13 @@ void GuiImage::SetPixel(int x, int y, GXColor color)
 	*(image+offset+1) = color.r;
 	*(image+offset+32) = color.g;
 	*(image+offset+33) = color.b;
+	Invalidate();
 }
 
 void GuiImage::SetStripe(int s)
 {
 	stripe = s;
+	Invalidate();
 }
 
 void GuiImage::ColorStripe(int shift)
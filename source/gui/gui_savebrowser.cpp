@@ -369,7 +369,8 @@ void GuiSaveBrowser::Update(GuiTrigger * t)
 			saveType[i]->SetText(savetext);
 
 			if(saves->previewImg[listOffset+i] != NULL)
-				savePreviewImg[i]->SetImage(saves->previewImg[listOffset+i]);
+				savePreviewImg[i]->SetImage(saves->previewImg[listOffset+i],
+					saves->previewWidth[listOffset+i], saves->previewHeight[listOffset+i]);
 			else
 				savePreviewImg[i]->SetImage(gameSaveBlank);
 		}
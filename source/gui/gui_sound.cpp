@@ -29,7 +29,7 @@ GuiSound::GuiSound(const u8 * s, s32 l, int t)
 GuiSound::~GuiSound()
 {
 	#ifndef NO_SOUND
-	if(type == SOUND_OGG)
+	if(type == SOUND_OGG || type == SOUND_OGG_FILE)
 		StopOgg();
 	#endif
 }
@@ -57,6 +57,15 @@ void GuiSound::Play()
 			PlayOgg((char *)sound, length, 0, OGG_ONE_TIME);
 		SetVolumeOgg(2.55f*(volume));
 		break;
+
+		case SOUND_OGG_FILE:
+		voice = 0;
+		if(loop)
+			PlayOggFile((const char *)sound, 0, OGG_INFINITE_TIME);
+		else
+			PlayOggFile((const char *)sound, 0, OGG_ONE_TIME);
+		SetVolumeOgg(2.55f*(volume));
+		break;
 	}
 	#endif
 }
@@ -74,6 +83,7 @@ void GuiSound::Stop()
 		break;
 
 		case SOUND_OGG:
+		case SOUND_OGG_FILE:
 		StopOgg();
 		break;
 	}
@@ -93,6 +103,7 @@ void GuiSound::Pause()
 		break;
 
 		case SOUND_OGG:
+		case SOUND_OGG_FILE:
 		PauseOgg(1);
 		break;
 	}
@@ -112,6 +123,7 @@ void GuiSound::Resume()
 		break;
 
 		case SOUND_OGG:
+		case SOUND_OGG_FILE:
 		PauseOgg(0);
 		break;
 	}
@@ -143,6 +155,7 @@ void GuiSound::SetVolume(int vol)
 		break;
 
 		case SOUND_OGG:
+		case SOUND_OGG_FILE:
 		SetVolumeOgg(2.55f*(volume));
 		break;
 	}
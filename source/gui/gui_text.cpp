@@ -52,6 +52,8 @@ GuiText::GuiText(const char * t, int s, GXColor c)
 
 	for(int i=0; i < 20; i++)
 		textDyn[i] = NULL;
+	textWidths = NULL;
+	textLayoutSize = 0;
 }
 
 /**
@@ -84,6 +86,8 @@ GuiText::GuiText(const char * t)
 
 	for(int i=0; i < 20; i++)
 		textDyn[i] = NULL;
+	textWidths = NULL;
+	textLayoutSize = 0;
 }
 
 /**
@@ -96,31 +100,24 @@ GuiText::~GuiText()
 	if(text)
 		delete[] text;
 
-	if(textDynNum > 0)
-	{
-		for(int i=0; i < textDynNum; i++)
-			if(textDyn[i])
-				delete[] textDyn[i];
-	}
+	ClearLayout();
 }
 
 void GuiText::SetText(const char * t)
 {
+	// lists set their rows every frame, so only an actual change redraws
+	if(t ? (origText && strcmp(t, origText) == 0) : (!origText && !text))
+		return;
+
 	if(origText)
 		free(origText);
 	if(text)
 		delete[] text;
 
-	if(textDynNum > 0)
-	{
-		for(int i=0; i < textDynNum; i++)
-			if(textDyn[i])
-				delete[] textDyn[i];
-	}
+	ClearLayout();
 
 	origText = NULL;
 	text = NULL;
-	textDynNum = 0;
 	textScrollPos = 0;
 	textScrollInitialDelay = TEXT_SCROLL_INITIAL_DELAY;
 
@@ -138,16 +135,10 @@ void GuiText::SetWText(wchar_t * t)
 	if(text)
 		delete[] text;
 
-	if(textDynNum > 0)
-	{
-		for(int i=0; i < textDynNum; i++)
-			if(textDyn[i])
-				delete[] textDyn[i];
-	}
+	ClearLayout();
 
 	origText = NULL;
 	text = NULL;
-	textDynNum = 0;
 	textScrollPos = 0;
 	textScrollInitialDelay = TEXT_SCROLL_INITIAL_DELAY;
 
@@ -176,22 +167,13 @@ void GuiText::SetPresets(int sz, GXColor c, int w, u16 s, int h, int v)
 void GuiText::SetFontSize(int s)
 {
 	size = s;
+	Invalidate();
 }
 
 void GuiText::SetMaxWidth(int width)
 {
 	maxWidth = width;
-
-	for(int i=0; i < textDynNum; i++)
-	{
-		if(textDyn[i])
-		{
-			delete[] textDyn[i];
-			textDyn[i] = NULL;
-		}
-	}
-
-	textDynNum = 0;
+	ClearLayout();
 }
 
 int GuiText::GetTextWidth()
@@ -215,17 +197,7 @@ void GuiText::SetWrap(bool w, int width)
 {
 	wrap = w;
 	maxWidth = width;
-
-	for(int i=0; i < textDynNum; i++)
-	{
-		if(textDyn[i])
-		{
-			delete[] textDyn[i];
-			textDyn[i] = NULL;
-		}
-	}
-
-	textDynNum = 0;
+	ClearLayout();
 }
 
 void GuiText::SetScroll(int s)
@@ -233,16 +205,7 @@ void GuiText::SetScroll(int s)
 	if(textScroll == s)
 		return;
 
-	for(int i=0; i < textDynNum; i++)
-	{
-		if(textDyn[i])
-		{
-			delete[] textDyn[i];
-			textDyn[i] = NULL;
-		}
-	}
-
-	textDynNum = 0;
+	ClearLayout();
 
 	textScroll = s;
 	textScrollPos = 0;
@@ -254,11 +217,13 @@ void GuiText::SetColor(GXColor c)
 {
 	color = c;
 	alpha = c.a;
+	Invalidate();
 }
 
 void GuiText::SetStyle(u16 s)
 {
 	style = s;
+	Invalidate();
 }
 
 void GuiText::SetAlignment(int hor, int vert)
@@ -292,6 +257,7 @@ void GuiText::SetAlignment(int hor, int vert)
 
 	alignmentHor = hor;
 	alignmentVert = vert;
+	Invalidate();
 }
 
 void GuiText::ResetText()
@@ -303,6 +269,12 @@ void GuiText::ResetText()
 
 	text = charToWideChar(gettext(origText));
 
+	ClearLayout();
+	currentSize = 0;
+}
+
+void GuiText::ClearLayout()
+{
 	for(int i=0; i < textDynNum; i++)
 	{
 		if(textDyn[i])
@@ -313,7 +285,92 @@ void GuiText::ResetText()
 	}
 
 	textDynNum = 0;
-	currentSize = 0;
+
+	if(textWidths)
+	{
+		delete[] textWidths;
+		textWidths = NULL;
+	}
+	Invalidate();
+}
+
+static wchar_t * CopyLine(const wchar_t * src, int len)
+{
+	wchar_t * line = new wchar_t[len + 1];
+	wmemcpy(line, src, len);
+	line[len] = 0;
+	return line;
+}
+
+/**
+ * Lays out the text in one pass. The width of every leading substring is
+ * measured once up front, so the width of any line is a subtraction.
+ */
+void GuiText::UpdateLayout()
+{
+	ClearLayout();
+
+	int textlen = wcslen(text);
+	textWidths = new int[textlen + 1];
+	fontSystem[currentSize]->getWidths(text, textWidths);
+	textLayoutSize = currentSize;
+
+	if(wrap)
+	{
+		int start = 0;
+		int lastSpace = -1;
+
+		for(int ch = 0; ch < textlen && textDynNum < 20; ch++)
+		{
+			if(text[ch] == ' ')
+			{
+				lastSpace = ch; // spaces may run past the edge
+				continue;
+			}
+
+			// break after the last word that fits, or mid-word if none does
+			while(ch > start && textWidths[ch+1] - textWidths[start] > maxWidth && textDynNum < 20)
+			{
+				if(lastSpace > start)
+				{
+					textDyn[textDynNum++] = CopyLine(&text[start], lastSpace - start);
+					start = lastSpace + 1; // discard the space
+					lastSpace = -1;
+				}
+				else
+				{
+					textDyn[textDynNum++] = CopyLine(&text[start], ch - start);
+					start = ch;
+				}
+			}
+		}
+
+		if(start < textlen && textDynNum < 20)
+			textDyn[textDynNum++] = CopyLine(&text[start], textlen - start);
+	}
+	else
+	{
+		// room for the two spaces added while scrolling
+		textDyn[0] = new wchar_t[textlen + 3];
+		textDynNum = 1;
+		wcscpy(textDyn[0], text);
+
+		if(textWidths[textlen] > maxWidth)
+		{
+			// scrolling text shows the rest soon enough, other text gets an ellipsis
+			bool ellipsis = (textScroll != SCROLL_HORIZONTAL);
+			int ellipsisWidth = ellipsis ? fontSystem[currentSize]->getWidth(L"...") : 0;
+			int len = textlen;
+
+			while(len > 0 && textWidths[len] + ellipsisWidth > maxWidth)
+				--len;
+
+			textDyn[0][len] = 0;
+
+			if(ellipsis)
+				wcscat(textDyn[0], L"...");
+		}
+	}
 }
 
 /**
@@ -350,55 +407,13 @@ void GuiText::Draw()
 		return;
 	}
 
+	if(!textWidths || textLayoutSize != currentSize)
+		UpdateLayout();
+
 	u32 textlen = wcslen(text);
 
 	if(wrap)
 	{
-		if(textDynNum == 0)
-		{
-			u32 n = 0, ch = 0;
-			int linenum = 0;
-			int lastSpace = -1;
-			int lastSpaceIndex = -1;
-
-			while(ch < textlen && linenum < 20)
-			{
-				if(n == 0)
-					textDyn[linenum] = new wchar_t[textlen + 1];
-
-				textDyn[linenum][n] = text[ch];
-				textDyn[linenum][n+1] = 0;
-
-				if(text[ch] == ' ' || ch == textlen-1)
-				{
-					if(fontSystem[currentSize]->getWidth(textDyn[linenum]) > maxWidth)
-					{
-						if(lastSpace >= 0)
-						{
-							textDyn[linenum][lastSpaceIndex] = 0; // discard space, and everything after
-							ch = lastSpace; // go backwards to the last space
-							lastSpace = -1; // we have used this space
-							lastSpaceIndex = -1;
-						}
-						++linenum;
-						n = -1;
-					}
-					else if(ch == textlen-1)
-					{
-						++linenum;
-					}
-				}
-				if(text[ch] == ' ' && n >= 0)
-				{
-					lastSpace = ch;
-					lastSpaceIndex = n;
-				}
-				++ch;
-				++n;
-			}
-			textDynNum = linenum;
-		}
-
 		int lineheight = newSize + 6;
 		int voffset = 0;
 
@@ -413,19 +428,12 @@ void GuiText::Draw()
 	}
 	else
 	{
-		if(textDynNum == 0)
-		{
-			textDynNum = 1;
-			textDyn[0] = wcsdup(text);
-			int len = wcslen(textDyn[0]);
-
-			while(fontSystem[currentSize]->getWidth(textDyn[0]) > maxWidth)
-				textDyn[0][--len] = 0;
-		}
-
 		if(textScroll == SCROLL_HORIZONTAL)
 		{
-			if(fontSystem[currentSize]->getWidth(text) > maxWidth && (FrameTimer % textScrollDelay == 0))
+			if(textWidths[textlen] > maxWidth)
+				Invalidate(); // keep drawing while the text scrolls
+
+			if(textWidths[textlen] > maxWidth && (FrameTimer % textScrollDelay == 0))
 			{
 				if(textScrollInitialDelay)
 				{
@@ -440,37 +448,26 @@ void GuiText::Draw()
 						textScrollInitialDelay = TEXT_SCROLL_INITIAL_DELAY;
 					}
 
-					wcscpy(textDyn[0], &text[textScrollPos]);
-					u32 dynlen = wcslen(textDyn[0]);
+					// the text is followed by two spaces and then repeats
+					int spaceWidth = fontSystem[currentSize]->getWidth(L" ");
+					int width = 0, w;
+					u32 dynlen = 0, i = textScrollPos;
 
-					if(dynlen+2 < textlen)
+					while(dynlen < textlen + 2)
 					{
-						textDyn[0][dynlen] = ' ';
-						textDyn[0][dynlen+1] = ' ';
-						textDyn[0][dynlen+2] = 0;
-						dynlen += 2;
-					}
+						if(i == textlen + 2)
+							i = 0;
 
-					if(fontSystem[currentSize]->getWidth(textDyn[0]) > maxWidth)
-					{
-						while(fontSystem[currentSize]->getWidth(textDyn[0]) > maxWidth)
-							textDyn[0][--dynlen] = 0;
-					}
-					else
-					{
-						int i = 0;
-
-						while(fontSystem[currentSize]->getWidth(textDyn[0]) < maxWidth && dynlen+1 < textlen)
-						{
-							textDyn[0][dynlen] = text[i++];
-							textDyn[0][++dynlen] = 0;
-						}
-
-						if(fontSystem[currentSize]->getWidth(textDyn[0]) > maxWidth)
-							textDyn[0][dynlen-2] = 0;
-						else
-							textDyn[0][dynlen-1] = 0;
+						w = i < textlen ? textWidths[i+1] - textWidths[i] : spaceWidth;
+
+						if(width + w > maxWidth)
+							break;
+
+						textDyn[0][dynlen++] = i < textlen ? text[i] : ' ';
+						width += w;
+						++i;
 					}
+					textDyn[0][dynlen] = 0;
 				}
 			}
 		}
@@ -59,6 +59,7 @@ void GuiWindow::Remove(GuiElement* e)
 		if(e == _elements.at(i))
 		{
 			_elements.erase(_elements.begin()+i);
+			Invalidate();
 			break;
 		}
 	}
@@ -67,6 +68,7 @@ void GuiWindow::Remove(GuiElement* e)
 void GuiWindow::RemoveAll()
 {
 	_elements.clear();
+	Invalidate();
 }
 
 bool GuiWindow::Find(GuiElement* e)
@@ -126,8 +128,11 @@ void GuiWindow::DrawTooltip()
 
 void GuiWindow::ResetState()
 {
-	if(state != STATE_DISABLED)
+	if(state != STATE_DISABLED && state != STATE_DEFAULT)
+	{
 		state = STATE_DEFAULT;
+		Invalidate();
+	}
 
 	u32 elemSize = _elements.size();
 	for (u32 i = 0; i < elemSize; ++i)
@@ -139,6 +144,9 @@ void GuiWindow::ResetState()
 
 void GuiWindow::SetState(int s)
 {
+	if(state != s)
+		Invalidate();
+
 	state = s;
 
 	u32 elemSize = _elements.size();
@@ -151,6 +159,9 @@ void GuiWindow::SetState(int s)
 
 void GuiWindow::SetVisible(bool v)
 {
+	if(visible != v)
+		Invalidate();
+
 	visible = v;
 
 	u32 elemSize = _elements.size();
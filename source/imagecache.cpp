@@ -0,0 +1,375 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * imagecache.cpp
+ *
+ * Background loading and caching of browser images
+ *
+ * PNGs (box art, screenshots) are decoded by a worker thread, scaled down to
+ * the size they are shown at, and kept as GX textures in a cache with a
+ * memory budget. The least recently used images are dropped first. Images
+ * that don't exist are remembered too, since most games have none.
+ ***************************************************************************/
+
+#include <gccore.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fileop.h"
+#include "imagecache.h"
+#include "utils/pngu.h"
+
+#define THREAD_SLEEP 100
+
+#define IMAGECACHE_ENTRIES 128
+#define IMAGECACHE_BUDGET (4*1024*1024)  // bytes of decoded images
+#define IMAGECACHE_QUEUE 8               // most images waiting to be loaded
+
+enum
+{
+	ENTRY_FREE,
+	ENTRY_QUEUED,
+	ENTRY_LOADING,
+	ENTRY_READY,
+	ENTRY_MISSING
+};
+
+typedef struct
+{
+	char path[MAXPATHLEN];
+	u32 hash;
+	int srcwidth;   // larger images are not loaded (0 for no limit)
+	int srcheight;
+	int maxwidth;
+	int maxheight;
+	int state;
+	bool wanted;    // requested for display, rather than prefetched
+	int holds;      // ImageCacheGet calls not yet released
+	u32 lastUse;    // for queued entries, when they were requested
+	u8 * image;
+	int width;
+	int height;
+	size_t bytes;
+} CACHEENTRY;
+
+static CACHEENTRY entries[IMAGECACHE_ENTRIES];
+static size_t cacheBytes = 0;
+static u32 useClock = 0;
+static mutex_t cacheLock = LWP_MUTEX_NULL;
+static lwp_t cachethread = LWP_THREAD_NULL;
+static volatile bool cacheStop = false;
+
+static u32 HashPath(const char * path)
+{
+	u32 h = 2166136261u; // FNV-1a
+	while(*path)
+		h = (h ^ (u8)*path++) * 16777619u;
+	return h;
+}
+
+static void FreeEntry(CACHEENTRY * e)
+{
+	if(e->image)
+	{
+		free(e->image);
+		cacheBytes -= e->bytes;
+	}
+	memset(e, 0, sizeof(CACHEENTRY));
+}
+
+static CACHEENTRY * FindEntry(const char * path, u32 hash, int srcwidth, int srcheight, int maxwidth, int maxheight)
+{
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+	{
+		CACHEENTRY * e = &entries[i];
+
+		if(e->state != ENTRY_FREE && e->hash == hash && e->srcwidth == srcwidth &&
+			e->srcheight == srcheight && e->maxwidth == maxwidth &&
+			e->maxheight == maxheight && strcmp(e->path, path) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * DropOldest
+ *
+ * Frees the least recently used entry in the given state that is not held.
+ * Returns false if there is none.
+ ***************************************************************************/
+static bool DropOldest(int state)
+{
+	CACHEENTRY * oldest = NULL;
+
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+	{
+		CACHEENTRY * e = &entries[i];
+
+		if(e->state == state && e->holds == 0 && (!oldest || e->lastUse < oldest->lastUse))
+			oldest = e;
+	}
+
+	if(!oldest)
+		return false;
+
+	FreeEntry(oldest);
+	return true;
+}
+
+/****************************************************************************
+ * NewEntry
+ *
+ * Finds room for a new entry, dropping the least recently used finished
+ * ones. Returns NULL if every entry is held or being loaded.
+ ***************************************************************************/
+static CACHEENTRY * NewEntry(const char * path, u32 hash, int srcwidth, int srcheight, int maxwidth, int maxheight)
+{
+	int queued = 0;
+	CACHEENTRY * e = NULL;
+
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+	{
+		if(entries[i].state == ENTRY_QUEUED)
+			queued++;
+		else if(entries[i].state == ENTRY_FREE && !e)
+			e = &entries[i];
+	}
+
+	// a request that has waited this long is no longer on screen
+	if(queued >= IMAGECACHE_QUEUE)
+		DropOldest(ENTRY_QUEUED);
+
+	if(!e)
+	{
+		if(!DropOldest(ENTRY_MISSING) && !DropOldest(ENTRY_READY))
+			return NULL;
+
+		for(int i=0; i < IMAGECACHE_ENTRIES && !e; i++)
+			if(entries[i].state == ENTRY_FREE)
+				e = &entries[i];
+	}
+
+	snprintf(e->path, MAXPATHLEN, "%s", path);
+	e->hash = hash;
+	e->srcwidth = srcwidth;
+	e->srcheight = srcheight;
+	e->maxwidth = maxwidth;
+	e->maxheight = maxheight;
+	e->state = ENTRY_QUEUED;
+	e->lastUse = ++useClock;
+	return e;
+}
+
+/****************************************************************************
+ * NextRequest
+ *
+ * The most recent request for display, otherwise the most recent prefetch
+ ***************************************************************************/
+static CACHEENTRY * NextRequest()
+{
+	CACHEENTRY * next = NULL;
+
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+	{
+		CACHEENTRY * e = &entries[i];
+
+		if(e->state != ENTRY_QUEUED)
+			continue;
+
+		if(!next || (e->wanted && !next->wanted) ||
+			(e->wanted == next->wanted && e->lastUse > next->lastUse))
+			next = e;
+	}
+	return next;
+}
+
+static void *
+cachecallback (void *arg)
+{
+	char path[MAXPATHLEN];
+	int srcwidth, srcheight, maxwidth, maxheight, width, height, device;
+
+	while(!cacheStop)
+	{
+		LWP_MutexLock(cacheLock);
+		CACHEENTRY * e = NextRequest();
+		if(e)
+		{
+			e->state = ENTRY_LOADING;
+			strcpy(path, e->path);
+			srcwidth = e->srcwidth ? e->srcwidth : INT_MAX;
+			srcheight = e->srcheight ? e->srcheight : INT_MAX;
+			maxwidth = e->maxwidth;
+			maxheight = e->maxheight;
+		}
+		LWP_MutexUnlock(cacheLock);
+
+		if(!e)
+		{
+			usleep(THREAD_SLEEP);
+			continue;
+		}
+
+		u8 * image = NULL;
+
+		if(FindDevice(path, &device))
+		{
+			AcquireDevice(device);
+			image = DecodePNGFromFileScaled(path, &width, &height,
+				srcwidth, srcheight, maxwidth, maxheight);
+			ReleaseDevice(device);
+		}
+
+		LWP_MutexLock(cacheLock);
+		e->lastUse = ++useClock;
+
+		if(image)
+		{
+			size_t bytes = width * height * 4;
+
+			while(cacheBytes + bytes > IMAGECACHE_BUDGET && DropOldest(ENTRY_READY));
+
+			e->image = image;
+			e->width = width;
+			e->height = height;
+			e->bytes = bytes;
+			e->state = ENTRY_READY;
+			cacheBytes += bytes;
+		}
+		else
+		{
+			e->state = ENTRY_MISSING;
+		}
+		LWP_MutexUnlock(cacheLock);
+	}
+	return NULL;
+}
+
+static bool StartCacheThread()
+{
+	if(cachethread != LWP_THREAD_NULL)
+		return true;
+
+	if(cacheLock == LWP_MUTEX_NULL)
+		LWP_MutexInit(&cacheLock, false);
+
+	cacheStop = false;
+
+	// below the GUI thread, so drawing comes first
+	if(LWP_CreateThread(&cachethread, cachecallback, NULL, NULL, 0, 60) < 0)
+	{
+		cachethread = LWP_THREAD_NULL;
+		return false;
+	}
+	return true;
+}
+
+/****************************************************************************
+ * ImageCacheGet
+ *
+ * Returns CACHE_READY with the image (a GX RGBA8 texture, scaled to fit
+ * maxwidth x maxheight) if it is cached, which is then kept until it is
+ * released with ImageCacheRelease. Otherwise queues the image to be loaded
+ * ahead of any prefetches and returns CACHE_LOADING, or CACHE_MISSING if it
+ * could not be loaded. Source images larger than srcwidth x srcheight are
+ * not loaded, unless these are 0.
+ ***************************************************************************/
+int ImageCacheGet(const char * path, int srcwidth, int srcheight, int maxwidth, int maxheight, u8 ** image, int * width, int * height)
+{
+	int state = CACHE_MISSING;
+
+	if(!StartCacheThread())
+		return CACHE_MISSING;
+
+	u32 hash = HashPath(path);
+
+	LWP_MutexLock(cacheLock);
+	CACHEENTRY * e = FindEntry(path, hash, srcwidth, srcheight, maxwidth, maxheight);
+
+	if(!e)
+		e = NewEntry(path, hash, srcwidth, srcheight, maxwidth, maxheight);
+
+	if(e)
+	{
+		switch(e->state)
+		{
+			case ENTRY_READY:
+				e->holds++;
+				e->lastUse = ++useClock;
+				*width = e->width;
+				*height = e->height;
+				*image = e->image;
+				state = CACHE_READY;
+				break;
+			case ENTRY_MISSING:
+				e->lastUse = ++useClock;
+				break;
+			default:
+				e->wanted = true;
+				state = CACHE_LOADING;
+				break;
+		}
+	}
+	LWP_MutexUnlock(cacheLock);
+	return state;
+}
+
+void ImageCacheRelease(u8 * image)
+{
+	if(!image || cacheLock == LWP_MUTEX_NULL)
+		return;
+
+	LWP_MutexLock(cacheLock);
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+	{
+		if(entries[i].image == image && entries[i].holds > 0)
+		{
+			entries[i].holds--;
+			break;
+		}
+	}
+	LWP_MutexUnlock(cacheLock);
+}
+
+/****************************************************************************
+ * ImageCachePrefetch
+ *
+ * Queues an image that is likely to be asked for next
+ ***************************************************************************/
+void ImageCachePrefetch(const char * path, int srcwidth, int srcheight, int maxwidth, int maxheight)
+{
+	if(!StartCacheThread())
+		return;
+
+	u32 hash = HashPath(path);
+
+	LWP_MutexLock(cacheLock);
+	if(!FindEntry(path, hash, srcwidth, srcheight, maxwidth, maxheight))
+		NewEntry(path, hash, srcwidth, srcheight, maxwidth, maxheight);
+	LWP_MutexUnlock(cacheLock);
+}
+
+/****************************************************************************
+ * ImageCacheClear
+ *
+ * Stops loading and frees all images. None may still be on screen.
+ ***************************************************************************/
+void ImageCacheClear()
+{
+	if(cachethread != LWP_THREAD_NULL)
+	{
+		cacheStop = true;
+		LWP_JoinThread(cachethread, NULL);
+		cachethread = LWP_THREAD_NULL;
+	}
+
+	for(int i=0; i < IMAGECACHE_ENTRIES; i++)
+		FreeEntry(&entries[i]);
+
+	cacheBytes = 0;
+}
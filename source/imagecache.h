@@ -0,0 +1,32 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * imagecache.h
+ *
+ * Background loading and caching of browser images
+ ***************************************************************************/
+
+#ifndef _IMAGECACHE_H_
+#define _IMAGECACHE_H_
+
+#include <gctypes.h>
+
+enum
+{
+	CACHE_LOADING,
+	CACHE_READY,
+	CACHE_MISSING
+};
+
+// largest box art that is loaded, for the srcwidth/srcheight limits
+#define IMAGE_MAX_WIDTH 640
+#define IMAGE_MAX_HEIGHT 480
+
+int ImageCacheGet(const char * path, int srcwidth, int srcheight, int maxwidth, int maxheight, u8 ** image, int * width, int * height);
+void ImageCacheRelease(u8 * image);
+void ImageCachePrefetch(const char * path, int srcwidth, int srcheight, int maxwidth, int maxheight);
+void ImageCacheClear();
+
+#endif
@@ -33,11 +33,14 @@
 #include "filelist.h"
 #include "menu.h"
 #include "gamesettings.h"
+#include "audiocapture.h"
+#include "imagecache.h"
 #include "gui/gui.h"
 #include "utils/gettext.h"
 #include "utils/FreeTypeGX.h"
 
 #define THREAD_SLEEP 100
+#define GUI_REFRESH_FRAMES 60 // redraw at least this often, even when nothing changed
 
 #ifdef HW_RVL
 GuiImageData * pointer[4];
@@ -60,7 +63,6 @@ static GuiButton * btnLogo = NULL;
 #ifdef HW_RVL
 static GuiButton * batteryBtn[4];
 #endif
-static GuiImageData * gameScreen = NULL;
 static GuiImage * gameScreenImg = NULL;
 static GuiImage * bgTopImg = NULL;
 static GuiImage * bgBottomImg = NULL;
@@ -85,6 +87,7 @@ static int progressTotal = 0;
 
 u8 * bg_music;
 u32 bg_music_size;
+char bg_music_file[MAXPATHLEN] = { 0 }; // custom track, streamed from file
 
 /****************************************************************************
  * ResumeGui
@@ -97,6 +100,7 @@ static void
 ResumeGui()
 {
 	guiHalt = false;
+	GuiElement::Invalidate();
 	LWP_ResumeThread (guithread);
 }
 
@@ -320,6 +324,10 @@ static void *
 UpdateGUI (void *arg)
 {
 	int i;
+	int idleFrames = 0;
+	#ifdef HW_RVL
+	bool pointerShown[4] = { false, false, false, false };
+	#endif
 
 	while(1)
 	{
@@ -327,24 +335,49 @@ UpdateGUI (void *arg)
 			LWP_SuspendThread(guithread);
 
 		UpdatePads();
-		mainWindow->Draw();
-
-		if (mainWindow->GetState() != STATE_DISABLED)
-			mainWindow->DrawTooltip();
 
 		#ifdef HW_RVL
-		i = 3;
-		do
+		// pointers are drawn over the GUI, so the GUI is redrawn while they show
+		for(i=0; i < 4; i++)
 		{
-			if(userInput[i].wpad->ir.valid)
-				Menu_DrawImg(userInput[i].wpad->ir.x-48, userInput[i].wpad->ir.y-48,
-					96, 96, pointer[i]->GetImage(), userInput[i].wpad->ir.angle, 1, 1, 255);
-			DoRumble(i);
-			--i;
-		} while(i>=0);
+			if(userInput[i].wpad->ir.valid || pointerShown[i])
+				GuiElement::Invalidate();
+			pointerShown[i] = userInput[i].wpad->ir.valid;
+		}
 		#endif
 
-		Menu_Render();
+		// when nothing changed, the last frame stays on screen
+		if(GuiElement::IsInvalidated() || ++idleFrames >= GUI_REFRESH_FRAMES)
+		{
+			idleFrames = 0;
+			GuiElement::Validate();
+			mainWindow->Draw();
+
+			if (mainWindow->GetState() != STATE_DISABLED)
+				mainWindow->DrawTooltip();
+
+			#ifdef HW_RVL
+			i = 3;
+			do
+			{
+				if(userInput[i].wpad->ir.valid)
+					Menu_DrawImg(userInput[i].wpad->ir.x-48, userInput[i].wpad->ir.y-48,
+						96, 96, pointer[i]->GetImage(), userInput[i].wpad->ir.angle, 1, 1, 255);
+				--i;
+			} while(i>=0);
+			#endif
+
+			Menu_Render();
+		}
+		else
+		{
+			VIDEO_WaitVSync();
+		}
+
+		#ifdef HW_RVL
+		for(i=0; i < 4; i++)
+			DoRumble(i);
+		#endif
 
 		mainWindow->Update(&userInput[3]);
 		mainWindow->Update(&userInput[2]);
@@ -942,6 +975,15 @@ static char* getImageFolder()
 	}
 }
 
+#define PREVIEW_WIDTH 225
+#define PREVIEW_HEIGHT 235
+#define PREVIEW_PREFETCH 2 // entries on either side of the selection
+
+static void GetPreviewPath(char * path, int index)
+{
+	snprintf(path, MAXJOLIET, "%s%s/%s.png", pathPrefix[GCSettings.LoadMethod], getImageFolder(), browserList[index].displayname);
+}
+
 static int MenuGameSelection()
 {
 	int menu = MENU_NONE;
@@ -1023,7 +1065,8 @@ static int MenuGameSelection()
 	GuiImage preview;
 	preview.SetAlignment(ALIGN_CENTRE, ALIGN_MIDDLE);
 	preview.SetPosition(174, -8);
-	u8* imgBuffer = MEM_ALLOC(640 * 480 * 4);
+	u8* previewImg = NULL; // held from the image cache
+	int previewState = CACHE_MISSING;
 	int  previousBrowserIndex = -1;
 	char imagePath[MAXJOLIET + 1];
 
@@ -1106,23 +1149,45 @@ static int MenuGameSelection()
 			}
 		}
 		
-		//update gamelist image
+		//update gamelist image - it's loaded in the background
 		if(previousBrowserIndex != browser.selIndex || previousPreviewImg != GCSettings.PreviewImage)
 		{
 			previousBrowserIndex = browser.selIndex;
 			previousPreviewImg = GCSettings.PreviewImage;
-			snprintf(imagePath, MAXJOLIET, "%s%s/%s.png", pathPrefix[GCSettings.LoadMethod], getImageFolder(), browserList[browser.selIndex].displayname);
+			GetPreviewPath(imagePath, browser.selIndex);
+			previewState = CACHE_LOADING;
 
+			// get the neighbours ready for scrolling
+			for(i = browser.selIndex - PREVIEW_PREFETCH; i <= browser.selIndex + PREVIEW_PREFETCH; i++)
+			{
+				if(i < 0 || i == browser.selIndex || i >= browser.numEntries || browserList[i].isdir)
+					continue;
+
+				char prefetchPath[MAXJOLIET + 1];
+				GetPreviewPath(prefetchPath, i);
+				ImageCachePrefetch(prefetchPath, IMAGE_MAX_WIDTH, IMAGE_MAX_HEIGHT,
+					PREVIEW_WIDTH, PREVIEW_HEIGHT);
+			}
+		}
+
+		if(previewState == CACHE_LOADING)
+		{
+			u8* img = NULL;
 			int width, height;
-			if(DecodePNGFromFile(imagePath, &width, &height, imgBuffer, 640, 480))
+			previewState = ImageCacheGet(imagePath, IMAGE_MAX_WIDTH, IMAGE_MAX_HEIGHT,
+				PREVIEW_WIDTH, PREVIEW_HEIGHT, &img, &width, &height);
+
+			if(previewState == CACHE_READY)
 			{
-				preview.SetImage(imgBuffer, width, height);
-				preview.SetScale( MIN(225.0f / width, 235.0f / height) );
+				preview.SetImage(img, width, height);
+				preview.SetScale( MIN((float)PREVIEW_WIDTH / width, (float)PREVIEW_HEIGHT / height) );
 			}
 			else
 			{
 				preview.SetImage(NULL, 0, 0);
 			}
+			ImageCacheRelease(previewImg);
+			previewImg = img;
 		}
 
 		if(settingsBtn.GetState() == STATE_CLICKED)
@@ -1144,7 +1209,7 @@ static int MenuGameSelection()
 	mainWindow->Remove(&gameBrowser);
 	mainWindow->Remove(&bgPreviewBtn);
 	mainWindow->Remove(&preview);
-	MEM_DEALLOC(imgBuffer);
+	ImageCacheClear();
 	return menu;
 }
 
@@ -1652,8 +1717,6 @@ static int MenuGame()
 				HaltGui();
 				mainWindow->Remove(gameScreenImg);
 				delete gameScreenImg;
-				delete gameScreen;
-				gameScreen = NULL;
 				ClearScreenshot();
 				if(GCSettings.AutoloadGame) {
 					ExitApp();
@@ -1766,6 +1829,7 @@ static int MenuGameSaves(int action)
 	char deletepath[1024];
 	char scrfile[1024];
 	char tmp[MAXJOLIET+1];
+	bool previewPending[MAX_SAVES+1];
 
 	int method = GCSettings.SaveMethod;
 
@@ -1843,8 +1907,6 @@ static int MenuGameSaves(int action)
 	len = strlen(ROMFilename);
 
 	// find matching files
-	AllocSaveBuffer();
-
 	for(i=0; i < browser.numEntries; i++)
 	{
 		len2 = strlen(browserList[i].filename);
@@ -1869,14 +1931,9 @@ static int MenuGameSaves(int action)
 			saves.files[saves.type[j]][n] = 1;
 			strcpy(saves.filename[j], browserList[i].filename);
 
-			if(saves.type[j] == FILE_SNAPSHOT)
-			{
-				sprintf(scrfile, "%s%s/%s.png", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, tmp);
+			// screenshots are loaded while the list is shown
+			previewPending[j] = (saves.type[j] == FILE_SNAPSHOT);
 
-				memset(savebuffer, 0, SAVEBUFFERSIZE);
-				if(LoadFile(scrfile, SILENT))
-					saves.previewImg[j] = new GuiImageData(savebuffer, 64, 48);
-			}
 			snprintf(filepath, 1024, "%s%s/%s", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, saves.filename[j]);
 			if (stat(filepath, &filestat) == 0)
 			{
@@ -1888,7 +1945,6 @@ static int MenuGameSaves(int action)
 		}
 	}
 
-	FreeSaveBuffer();
 	saves.length = j;
 
 	if((saves.length == 0 && action == 0) || (saves.length == 0 && action == 2)) 
@@ -1910,6 +1966,34 @@ static int MenuGameSaves(int action)
 	{
 		usleep(THREAD_SLEEP);
 
+		// one screenshot at a time, in list order
+		for(i=0; i < saves.length; i++)
+		{
+			if(!previewPending[i])
+				continue;
+
+			strcpy(tmp, saves.filename[i]);
+			tmp[strlen(tmp)-4] = 0;
+			sprintf(scrfile, "%s%s/%s.png", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, tmp);
+
+			u8 * img = NULL;
+			int width, height;
+			// save screenshots are the size of the EFB they were taken in
+			int state = ImageCacheGet(scrfile, 0, 0, 64, 48, &img, &width, &height);
+
+			if(state == CACHE_LOADING)
+				break;
+
+			previewPending[i] = false;
+
+			if(state == CACHE_READY)
+			{
+				saves.previewWidth[i] = width;
+				saves.previewHeight[i] = height;
+				saves.previewImg[i] = img;
+			}
+		}
+
 		ret = saveBrowser.GetClickedSave();
 
 		// load, save and delete save games
@@ -2030,14 +2114,10 @@ static int MenuGameSaves(int action)
 	}
 
 	HaltGui();
-
-	for(i=0; i < saves.length; i++)
-		if(saves.previewImg[i])
-			delete saves.previewImg[i];
-
 	mainWindow->Remove(&saveBrowser);
 	mainWindow->Remove(&w);
 	mainWindow->Remove(&titleTxt);
+	ImageCacheClear();
 	ResetBrowser();
 	return menu;
 }
@@ -3098,6 +3178,8 @@ static int MenuSettingsVideo()
 	sprintf(options.name[i++], "GB Mono Colorization");
 	sprintf(options.name[i++], "GB Palette");
 	sprintf(options.name[i++], "GBA Frameskip");
+	sprintf(options.name[i++], "Screen Effect");
+	sprintf(options.name[i++], "Frame Blending");
 	options.length = i;
 
 	for(i=0; i < options.length; i++)
@@ -3208,6 +3290,16 @@ static int MenuSettingsVideo()
 			case 8:
 				GCSettings.gbaFrameskip ^= 1;
 				break;
+
+			case 9:
+				GCSettings.postfilter++;
+				if (GCSettings.postfilter >= POSTFILTER_LENGTH)
+					GCSettings.postfilter = POSTFILTER_NONE;
+				break;
+
+			case 10:
+				GCSettings.frameblend ^= 1;
+				break;
 		}
 
 		if(ret >= 0 || firstRun)
@@ -3290,6 +3382,18 @@ static int MenuSettingsVideo()
 			else
 				sprintf (options.value[8], "Off");
 
+			if (GCSettings.postfilter == POSTFILTER_LCD_GRID)
+				sprintf (options.value[9], "LCD Grid");
+			else if (GCSettings.postfilter == POSTFILTER_SCANLINES)
+				sprintf (options.value[9], "Scanlines");
+			else
+				sprintf (options.value[9], "None");
+
+			if (GCSettings.frameblend)
+				sprintf (options.value[10], "On");
+			else
+				sprintf (options.value[10], "Off");
+
 			optionBrowser.TriggerUpdate();
 		}
 
@@ -3317,6 +3421,7 @@ static int MenuSettingsEmulation()
 	sprintf(options.name[i++], "Super Game Boy border");
 	sprintf(options.name[i++], "Offset from UTC (hours)");
 	sprintf(options.name[i++], "GB Screen Palette");
+	sprintf(options.name[i++], "Audio Capture");
 	options.length = i;
 
 	for(i=0; i < options.length; i++)
@@ -3388,6 +3493,11 @@ static int MenuSettingsEmulation()
 			case 3:
 				GCSettings.BasicPalette ^= 1;
 				break;
+			case 4:
+				GCSettings.AudioCapture++;
+				if (GCSettings.AudioCapture > CAPTURE_CHANNELS)
+					GCSettings.AudioCapture = CAPTURE_OFF;
+				break;
 		}
 
 		if(ret >= 0 || firstRun)
@@ -3420,6 +3530,13 @@ static int MenuSettingsEmulation()
 				sprintf (options.value[3], "Green Screen");
 			else
 				sprintf (options.value[3], "Monochrome Screen");
+
+			if (GCSettings.AudioCapture == CAPTURE_OFF)
+				sprintf (options.value[4], "Off");
+			else if (GCSettings.AudioCapture == CAPTURE_MIX)
+				sprintf (options.value[4], "Mixed Output");
+			else
+				sprintf (options.value[4], "Mixed + Channels");
 			
 			
 			optionBrowser.TriggerUpdate();
@@ -4867,8 +4984,7 @@ MainMenu (int menu)
 
 	if(menu == MENU_GAME)
 	{
-		gameScreen = new GuiImageData(gameScreenPng);
-		gameScreenImg = new GuiImage(gameScreen);
+		gameScreenImg = new GuiImage(gameScreenTex, vmode->fbWidth, vmode->efbHeight);
 		gameScreenImg->SetAlpha(192);
 		gameScreenImg->ColorStripe(30);
 		gameScreenImg->SetScaleX(screenwidth/(float)vmode->fbWidth);
@@ -4933,9 +5049,20 @@ MainMenu (int menu)
 	}
 #endif
 
+	int droppedFrames = AudioCaptureDroppedFrames();
+	if(droppedFrames > 0)
+	{
+		char msg[100];
+		sprintf(msg, "Audio capture fell behind. %d frames were replaced with silence.", droppedFrames);
+		InfoPrompt(msg);
+	}
+
 	#ifndef NO_SOUND
 	if(firstRun) {
-		bgMusic = new GuiSound(bg_music, bg_music_size, SOUND_OGG);
+		if(bg_music_file[0])
+			bgMusic = new GuiSound((u8 *)bg_music_file, 0, SOUND_OGG_FILE);
+		else
+			bgMusic = new GuiSound(bg_music, bg_music_size, SOUND_OGG);
 		bgMusic->SetVolume(GCSettings.MusicVolume);
 		bgMusic->SetLoop(true);
 		enterSound = new GuiSound(enter_ogg, enter_ogg_size, SOUND_OGG);
@@ -5026,9 +5153,6 @@ MainMenu (int menu)
 
 	mainWindow = NULL;
 
-	if(gameScreen)
-		delete gameScreen;
-
 	ClearScreenshot();
 
 	// wait for keys to be depressed
@@ -29,6 +29,7 @@ void ChangeLanguage();
 
 extern u8 * bg_music;
 extern u32 bg_music_size;
+extern char bg_music_file[];
 
 enum
 {
@@ -23,6 +23,7 @@
 #include "input.h"
 #include "button_mapping.h"
 #include "gamesettings.h"
+#include "video.h"
 
 struct SGCSettings GCSettings;
 static gamePalette *palettes = NULL;
@@ -192,6 +193,8 @@ preparePrefsData ()
 	createXMLSetting("gbFixed", "GB Fixed Pixel Ratio", toStr(GCSettings.gbFixed));
 	createXMLSetting("gbaFixed", "GBA Fixed Pixel Ratio", toStr(GCSettings.gbaFixed));
 	createXMLSetting("render", "Video Filtering", toStr(GCSettings.render));
+	createXMLSetting("postfilter", "Screen Effect", toStr(GCSettings.postfilter));
+	createXMLSetting("frameblend", "Frame Blending", toStr(GCSettings.frameblend));
 	createXMLSetting("scaling", "Aspect Ratio Correction", toStr(GCSettings.scaling));
 	createXMLSetting("xshift", "Horizontal Video Shift", toStr(GCSettings.xshift));
 	createXMLSetting("yshift", "Vertical Video Shift", toStr(GCSettings.yshift));
@@ -507,6 +510,8 @@ decodePrefsData ()
 			loadXMLSetting(&GCSettings.gbaFixed, "gbaFixed");
 			loadXMLSetting(&GCSettings.gbFixed, "gbFixed");
 			loadXMLSetting(&GCSettings.render, "render");
+			loadXMLSetting(&GCSettings.postfilter, "postfilter");
+			loadXMLSetting(&GCSettings.frameblend, "frameblend");
 			loadXMLSetting(&GCSettings.scaling, "scaling");
 			loadXMLSetting(&GCSettings.xshift, "xshift");
 			loadXMLSetting(&GCSettings.yshift, "yshift");
@@ -613,6 +618,8 @@ void FixInvalidSettings()
 		GCSettings.language = LANG_ENGLISH;
 	if(!(GCSettings.render >= 0 && GCSettings.render < 5))
 		GCSettings.render = 1;
+	if(!(GCSettings.postfilter >= 0 && GCSettings.postfilter < POSTFILTER_LENGTH))
+		GCSettings.postfilter = POSTFILTER_NONE;
 	if(!(GCSettings.videomode >= 0 && GCSettings.videomode < 7))
 		GCSettings.videomode = 0;
 }
@@ -651,6 +658,8 @@ DefaultSettings ()
 	GCSettings.gbaFixed = 0; // not fixed - use zoom level
 	GCSettings.videomode = 0; // automatic video mode detection
 	GCSettings.render = 1; // Filtered
+	GCSettings.postfilter = POSTFILTER_NONE; // no screen effect
+	GCSettings.frameblend = 0; // no frame blending
 	GCSettings.scaling = 1; // partial stretch
 	GCSettings.WiiControls = false; // Match Wii Game
 
@@ -662,6 +671,7 @@ DefaultSettings ()
 	GCSettings.WiimoteOrientation = 0;
 	GCSettings.ExitAction = 0;
 	GCSettings.AutoloadGame = 0;
+	GCSettings.AudioCapture = 0;
 	GCSettings.MusicVolume = 20;
 	GCSettings.SFXVolume = 40;
 	GCSettings.Rumble = 1;
@@ -0,0 +1,116 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * romsniff.cpp
+ *
+ * ROM type detection from file contents
+ *
+ * Works out whether a file (or the ROM inside a zip) is a GBA or GB image
+ * from its cartridge header, reading only the zip's central directory and
+ * the start of the ROM instead of the whole thing. Goomba images are GBA
+ * images here; the loader finds the Game Boy ROMs inside them.
+ ***************************************************************************/
+
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fileop.h"
+#include "gcunzip.h"
+#include "romsniff.h"
+#include "goomba/goombarom.h"
+
+#define SNIFF_HEADER_SIZE 0x200 // covers the GBA and GB headers
+
+/****************************************************************************
+ * IsGBAHeader
+ *
+ * The fixed value at 0xB2 and the header complement at 0xBD are checked by
+ * the BIOS. Multiboot images and some homebrew leave the complement unset,
+ * so a branch at the entry point will do instead.
+ ***************************************************************************/
+static bool IsGBAHeader(const u8 * h)
+{
+	if(h[0xB2] != 0x96)
+		return false;
+
+	u8 chk = 0;
+	for(int i = 0xA0; i < 0xBD; i++)
+		chk -= h[i];
+	chk -= 0x19;
+
+	return chk == h[0xBD] || h[3] == 0xEA; // ARM "b" instruction
+}
+
+/****************************************************************************
+ * SniffRomHeader
+ *
+ * Identifies the ROM image starting at data
+ ***************************************************************************/
+int SniffRomHeader(const u8 * data, size_t length, ROMSNIFF * info)
+{
+	info->type = ROMTYPE_UNKNOWN;
+	info->cgb = info->sgb = false;
+	info->title[0] = 0;
+
+	if(length >= 0xC0 && IsGBAHeader(data))
+	{
+		info->type = ROMTYPE_GBA;
+		memcpy(info->title, &data[0xA0], 12);
+		info->title[12] = 0;
+	}
+	else if(length >= 0x150 && gb_first_rom(data, 0x150) == data)
+	{
+		info->type = ROMTYPE_GB;
+		info->cgb = (data[0x143] & 0x80) != 0;
+		info->sgb = data[0x146] == 0x03 && data[0x14B] == 0x33;
+		// CGB titles share their last bytes with the flag
+		memcpy(info->title, &data[0x134], info->cgb ? 15 : 16);
+		info->title[info->cgb ? 15 : 16] = 0;
+	}
+	return info->type;
+}
+
+/****************************************************************************
+ * SniffRom
+ *
+ * Identifies the ROM in filepath, which may be zipped. Returns false if the
+ * file (or the zip) could not be read. info->type is ROMTYPE_UNKNOWN if the
+ * header was not recognized, in which case the file extension, or the zip
+ * member's, is all there is to go by.
+ ***************************************************************************/
+bool SniffRom(char * filepath, ROMSNIFF * info)
+{
+	u8 header[SNIFF_HEADER_SIZE];
+	int device;
+	bool ok = false;
+
+	memset(info, 0, sizeof(ROMSNIFF));
+
+	if(!FindDevice(filepath, &device))
+		return false;
+
+	AcquireDevice(device);
+
+	FILE * fp = fopen(filepath, "rb");
+
+	if(fp)
+	{
+		size_t len = fread(header, 1, 4, fp);
+
+		if(len == 4 && IsZipFile((char *)header))
+			len = ReadZipHead(fp, header, SNIFF_HEADER_SIZE, info->member, sizeof(info->member));
+		else
+			len += fread(header + len, 1, SNIFF_HEADER_SIZE - len, fp);
+
+		ok = len > 0;
+		SniffRomHeader(header, len, info);
+		fclose(fp);
+	}
+
+	ReleaseDevice(device);
+	return ok;
+}
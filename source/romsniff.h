@@ -0,0 +1,36 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * Tantric 2008-2021
+ *
+ * romsniff.h
+ *
+ * ROM type detection from file contents
+ ***************************************************************************/
+
+#ifndef _ROMSNIFF_H_
+#define _ROMSNIFF_H_
+
+#include <gctypes.h>
+#include <stddef.h>
+
+enum
+{
+	ROMTYPE_UNKNOWN,
+	ROMTYPE_GB,     // same numbering as cartridgeType
+	ROMTYPE_GBA
+};
+
+typedef struct
+{
+	int type;          // ROMTYPE_*
+	bool cgb;          // GB: uses Game Boy Color features
+	bool sgb;          // GB: uses Super Game Boy features
+	char title[17];    // internal title from the header
+	char member[256];  // name of the zip member the header was read from
+} ROMSNIFF;
+
+int SniffRomHeader(const u8 * data, size_t length, ROMSNIFF * info);
+bool SniffRom(char * filepath, ROMSNIFF * info);
+
+#endif
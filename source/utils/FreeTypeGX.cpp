@@ -102,6 +102,13 @@ FreeTypeGX::FreeTypeGX(FT_UInt pixelSize, uint8_t vertexIndex)
 	this->setCompatibilityMode(FTGX_COMPATIBILITY_DEFAULT_TEVOP_GX_PASSCLR | FTGX_COMPATIBILITY_DEFAULT_VTXDESC_GX_NONE);
 	this->ftPointSize = pixelSize;
 	this->ftKerningEnabled = FT_HAS_KERNING(ftFace);
+
+	memset(this->glyphTable, 0, sizeof(this->glyphTable));
+	this->atlasPageCount = 0;
+	this->atlasSize = pixelSize <= 32 ? 256 : 512;
+	this->shelfX = this->shelfY = this->shelfHeight = 0;
+	this->atlasDirty = false;
+	this->atlasFull = false;
 }
 
 /**
@@ -198,15 +205,59 @@ void FreeTypeGX::setDefaultMode()
 /**
  * Clears all loaded font glyph data.
  *
- * This routine clears all members of the font map structure and frees all allocated memory back to the system.
+ * This routine clears the glyph lookup table, the font map structure and the atlas pages and frees all allocated memory back to the system.
  */
 void FreeTypeGX::unloadFont()
 {
-	if(this->fontData.size() == 0)
-		return;
-	for(std::map<wchar_t, ftgxCharData>::iterator i = this->fontData.begin(), iEnd = this->fontData.end(); i != iEnd; ++i)
-		free(i->second.glyphDataTexture);
+	for(int i = 0; i < 256; i++)
+	{
+		free(this->glyphTable[i]);
+		this->glyphTable[i] = NULL;
+	}
 	this->fontData.clear();
+
+	for(int i = 0; i < this->atlasPageCount; i++)
+		free(this->atlasPages[i].texture);
+	this->atlasPageCount = 0;
+	this->shelfX = this->shelfY = this->shelfHeight = 0;
+	this->atlasFull = false;
+}
+
+/**
+ * Empties the glyph atlas after a glyph did not fit.
+ *
+ * The pages are freed and every glyph with a bitmap goes back to uncached, so the glyphs still in use are packed
+ * again as they are drawn. Waits for the GPU first, since quads already queued may still read the pages.
+ */
+void FreeTypeGX::resetAtlas()
+{
+	GX_DrawDone();
+
+	for(int i = 0; i < 256; i++)
+	{
+		if(this->glyphTable[i] == NULL)
+			continue;
+
+		for(int j = 0; j < 256; j++)
+		{
+			ftgxCharData *charData = &this->glyphTable[i][j];
+			if(charData->cached == FTGX_GLYPH_LOADED && charData->textureWidth)
+				charData->cached = FTGX_GLYPH_NONE;
+		}
+	}
+
+	for(std::map<wchar_t, ftgxCharData>::iterator it = this->fontData.begin(); it != this->fontData.end(); ++it)
+	{
+		if(it->second.cached == FTGX_GLYPH_LOADED && it->second.textureWidth)
+			it->second.cached = FTGX_GLYPH_NONE;
+	}
+
+	for(int i = 0; i < this->atlasPageCount; i++)
+		free(this->atlasPages[i].texture);
+	this->atlasPageCount = 0;
+	this->shelfX = this->shelfY = this->shelfHeight = 0;
+	this->atlasFull = false;
+	this->atlasDirty = true;
 }
 
 uint16_t FreeTypeGX::adjustTextureWidth(uint16_t textureWidth)
@@ -222,18 +273,55 @@ uint16_t FreeTypeGX::adjustTextureHeight(uint16_t textureHeight)
 }
 
 /**
- * Caches the given font glyph in the instance font texture buffer.
+ * Returns the glyph data for the given character, caching the glyph on first use.
+ *
+ * Characters of the Basic Multilingual Plane are found through a flat lookup table, the rest through the font map.
+ * Characters which are not in the font face are remembered, so they are only looked up once. A glyph that did not
+ * fit into the atlas is tried again on its next use.
+ *
+ * @param charCode	The requested glyph's character code.
+ * @return A pointer to the font structure, or NULL if the glyph is not available.
+ */
+ftgxCharData *FreeTypeGX::getGlyphData(wchar_t charCode)
+{
+	ftgxCharData *charData;
+
+	if((uint32_t) charCode < 0x10000)
+	{
+		ftgxCharData *&block = this->glyphTable[(charCode >> 8) & 0xFF];
+		if(block == NULL)
+		{
+			block = (ftgxCharData *) calloc(256, sizeof(ftgxCharData));
+			if(block == NULL)
+				return NULL;
+		}
+		charData = &block[charCode & 0xFF];
+	}
+	else
+	{
+		charData = &this->fontData[charCode];
+	}
+
+	if(charData->cached == FTGX_GLYPH_LOADED)
+		return charData;
+	if(charData->cached == FTGX_GLYPH_MISSING)
+		return NULL;
+	return this->cacheGlyphData(charCode, charData);
+}
+
+/**
+ * Caches the given font glyph in the instance glyph atlas.
  *
- * This routine renders and stores the requested glyph's bitmap and relevant information into its own quickly addressible
- * structure within an instance-specific map.
+ * This routine renders the requested glyph, packs its bitmap into the atlas and stores the relevant information
+ * into the supplied structure.
  *
  * @param charCode	The requested glyph's character code.
- * @return A pointer to the allocated font structure.
+ * @param charData	The structure to fill in.
+ * @return A pointer to the font structure, or NULL if the glyph could not be cached.
  */
-ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode)
+ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode, ftgxCharData *charData)
 {
 	FT_UInt gIndex;
-	uint16_t textureWidth = 0, textureHeight = 0;
 
 	gIndex = FT_Get_Char_Index(ftFace, (FT_ULong) charCode);
 	if (gIndex != 0 && FT_Load_Glyph(ftFace, gIndex, FT_LOAD_DEFAULT | FT_LOAD_RENDER) == 0)
@@ -242,28 +330,47 @@ ftgxCharData *FreeTypeGX::cacheGlyphData(wchar_t charCode)
 		{
 			FT_Bitmap *glyphBitmap = &ftSlot->bitmap;
 
-			textureWidth = ALIGN8(glyphBitmap->width);
-			textureHeight = ALIGN8(glyphBitmap->rows);
-			if(textureWidth == 0)
-				textureWidth = 8;
-			if(textureHeight == 0)
-				textureHeight = 8;
-
-			this->fontData[charCode].renderOffsetX = (int16_t) ftFace->glyph->bitmap_left;
-			this->fontData[charCode].glyphAdvanceX = (uint16_t) (ftFace->glyph->advance.x >> 6);
-			this->fontData[charCode].glyphIndex = (uint32_t) gIndex;
-			this->fontData[charCode].textureWidth = (uint16_t) textureWidth;
-			this->fontData[charCode].textureHeight = (uint16_t) textureHeight;
-			this->fontData[charCode].renderOffsetY = (int16_t) ftFace->glyph->bitmap_top;
-			this->fontData[charCode].renderOffsetMax = (int16_t) ftFace->glyph->bitmap_top;
-			this->fontData[charCode].renderOffsetMin = (int16_t) glyphBitmap->rows - ftFace->glyph->bitmap_top;
-			this->fontData[charCode].glyphDataTexture = NULL;
-
-			this->loadGlyphData(glyphBitmap, &this->fontData[charCode]);
-
-			return &this->fontData[charCode];
+			charData->renderOffsetX = (int16_t) ftFace->glyph->bitmap_left;
+			charData->glyphAdvanceX = (uint16_t) (ftFace->glyph->advance.x >> 6);
+			charData->glyphIndex = (uint32_t) gIndex;
+			charData->renderOffsetY = (int16_t) ftFace->glyph->bitmap_top;
+			charData->renderOffsetMax = (int16_t) ftFace->glyph->bitmap_top;
+			charData->renderOffsetMin = (int16_t) glyphBitmap->rows - ftFace->glyph->bitmap_top;
+			charData->textureWidth = 0;
+			charData->textureHeight = 0;
+
+			// glyphs without a bitmap (spaces) only advance the pen
+			if(glyphBitmap->width > 0 && glyphBitmap->rows > 0)
+			{
+				// keep a blank texel to the right and below, so filtering never picks up the neighbouring glyph
+				charData->textureWidth = ALIGN8(glyphBitmap->width + 1);
+				charData->textureHeight = ALIGN8(glyphBitmap->rows + 1);
+
+				if(charData->textureWidth > this->atlasSize || charData->textureHeight > this->atlasSize)
+				{
+					// too big for any page, so it only advances the pen
+					charData->textureWidth = 0;
+					charData->textureHeight = 0;
+				}
+				else if(this->atlasFull || !this->allocGlyphSpace(charData))
+				{
+					// out of atlas space, so the glyph is blank for now and stays uncached until the atlas is emptied
+					this->atlasFull = true;
+					charData->textureWidth = 0;
+					charData->textureHeight = 0;
+					return charData;
+				}
+				else
+				{
+					this->loadGlyphData(glyphBitmap, charData);
+				}
+			}
+
+			charData->cached = FTGX_GLYPH_LOADED;
+			return charData;
 		}
 	}
+	charData->cached = FTGX_GLYPH_MISSING;
 	return NULL;
 }
 
@@ -280,7 +387,7 @@ uint16_t FreeTypeGX::cacheGlyphDataComplete()
 	FT_ULong charCode = FT_Get_First_Char( ftFace, &gIndex );
 	while ( gIndex != 0 )
 	{
-		if(this->cacheGlyphData(charCode) != NULL)
+		if(this->getGlyphData(charCode) != NULL)
 			++i;
 		charCode = FT_Get_Next_Char( ftFace, charCode, &gIndex );
 	}
@@ -288,31 +395,85 @@ uint16_t FreeTypeGX::cacheGlyphDataComplete()
 }
 
 /**
- * Loads the rendered bitmap into the relevant structure's data buffer.
+ * Reserves space for a glyph bitmap in the atlas.
+ *
+ * Glyphs are packed left to right into shelves as tall as the tallest glyph on them. A new page is allocated
+ * once the last one is full. Fails when all pages are full or a page cannot be allocated.
+ *
+ * @param charData	A pointer to an ftgxCharData structure with the texture size set. Its atlas position is filled in.
+ * @return true if space was found.
+ */
+bool FreeTypeGX::allocGlyphSpace(ftgxCharData *charData)
+{
+	uint16_t width = charData->textureWidth;
+	uint16_t height = charData->textureHeight;
+
+	if(width > this->atlasSize || height > this->atlasSize)
+		return false;
+
+	if(this->atlasPageCount > 0 && this->shelfX + width > this->atlasSize)
+	{
+		this->shelfX = 0;
+		this->shelfY += this->shelfHeight;
+		this->shelfHeight = 0;
+	}
+
+	if(this->atlasPageCount == 0 || this->shelfY + height > this->atlasSize)
+	{
+		if(this->atlasPageCount == FTGX_ATLAS_PAGES)
+			return false;
+
+		int pageSize = (this->atlasSize * this->atlasSize) >> 1;
+		uint8_t *texture = (uint8_t *) memalign(32, pageSize);
+		if(texture == NULL)
+			return false;
+
+		memset(texture, 0x00, pageSize);
+		DCFlushRange(texture, pageSize);
+
+		ftgxAtlasPage *page = &this->atlasPages[this->atlasPageCount++];
+		page->texture = texture;
+		GX_InitTexObj(&page->texObj, texture, this->atlasSize, this->atlasSize, GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
+
+		this->shelfX = this->shelfY = this->shelfHeight = 0;
+	}
+
+	charData->atlasPage = this->atlasPageCount - 1;
+	charData->atlasX = this->shelfX;
+	charData->atlasY = this->shelfY;
+
+	this->shelfX += width;
+	if(height > this->shelfHeight)
+		this->shelfHeight = height;
+	return true;
+}
+
+/**
+ * Loads the rendered bitmap into the glyph's space in the atlas.
  *
- * This routine does a simple byte-wise copy of the glyph's rendered 8-bit grayscale bitmap into the structure's buffer.
- * Each byte is converted from the bitmap's intensity value into the a uint32_t RGBA value.
+ * This routine converts the glyph's rendered 8-bit grayscale bitmap to 4-bit intensity values and writes them
+ * straight into the 8x8 texel tiles of the atlas page.
  *
  * @param bmp	A pointer to the most recently rendered glyph's bitmap.
  * @param charData	A pointer to an allocated ftgxCharData structure whose data represent that of the last rendered glyph.
- *
- * Optimized for RGBA8 use by Dimok.
  */
 void FreeTypeGX::loadGlyphData(FT_Bitmap *bmp, ftgxCharData *charData)
 {
-	int glyphSize = (charData->textureWidth * charData->textureHeight) >> 1;
-
-	uint8_t *glyphData = (uint8_t *) memalign(32, glyphSize);
-	memset(glyphData, 0x00, glyphSize);
+	uint8_t *texture = this->atlasPages[charData->atlasPage].texture;
+	uint16_t tilesWide = this->atlasSize >> 3;
 
 	uint8_t *src = (uint8_t *)bmp->buffer;
-	uint8_t *dst = glyphData;
+	uint8_t *tile, *dst;
 	int32_t pos, x1, y1, x, y;
 
 	for(y1 = 0; y1 < bmp->rows; y1 += 8)
 	{
 		for(x1 = 0; x1 < bmp->width; x1 += 8)
 		{
+			// each I4 tile is 32 bytes
+			tile = texture + ((((charData->atlasY + y1) >> 3) * tilesWide + ((charData->atlasX + x1) >> 3)) << 5);
+			dst = tile;
+
 			for(y = y1; y < (y1 + 8); y++)
 			{
 				for(x = x1; x < (x1 + 8); x += 2, dst++)
@@ -327,11 +488,10 @@ void FreeTypeGX::loadGlyphData(FT_Bitmap *bmp, ftgxCharData *charData)
 						*dst |= (src[pos + 1] >> 4);
 				}
 			}
+			DCFlushRange(tile, 32);
 		}
 	}
-
-	DCFlushRange(glyphData, glyphSize);
-	charData->glyphDataTexture = glyphData;
+	this->atlasDirty = true;
 }
 
 /**
@@ -393,8 +553,8 @@ int16_t FreeTypeGX::getStyleOffsetHeight(ftgxDataOffset *offset, uint16_t format
 /**
  * Processes the supplied text string and prints the results at the specified coordinates.
  *
- * This routine processes each character of the supplied text string, loads the relevant preprocessed bitmap buffer,
- * a texture from said buffer, and loads the resultant texture into the EFB.
+ * This routine looks up each character of the supplied text string in the glyph atlas and draws the whole string
+ * as one batch of quads for each atlas page it uses, with a single texture load per page.
  *
  * @param x	Screen X coordinate at which to output the text.
  * @param y Screen Y coordinate at which to output the text. Note that this value corresponds to the text string origin and not the top or bottom of the glyphs.
@@ -405,11 +565,17 @@ int16_t FreeTypeGX::getStyleOffsetHeight(ftgxDataOffset *offset, uint16_t format
  */
 uint16_t FreeTypeGX::drawText(int16_t x, int16_t y, wchar_t *text, GXColor color, uint16_t textStyle)
 {
-	uint16_t x_pos = x, printed = 0;
+	uint16_t x_pos, printed = 0;
 	uint16_t x_offset = 0, y_offset = 0;
-	GXTexObj glyphTexture;
+	uint16_t pageGlyphs[FTGX_ATLAS_PAGES];
 	FT_Vector pairDelta;
 	ftgxDataOffset offset;
+	ftgxCharData *glyphData, *prevData;
+	int i;
+
+	// a glyph didn't fit last time, so start the atlas over with the glyphs in use
+	if(this->atlasFull)
+		this->resetAtlas();
 
 	if(textStyle & FTGX_JUSTIFY_MASK)
 	{
@@ -421,36 +587,65 @@ uint16_t FreeTypeGX::drawText(int16_t x, int16_t y, wchar_t *text, GXColor color
 		y_offset = this->getStyleOffsetHeight(&offset, textStyle);
 	}
 
-	int i = 0;
-	while (text[i])
+	// count the quads on each atlas page, caching any new glyphs first
+	memset(pageGlyphs, 0, sizeof(pageGlyphs));
+	for(i = 0; text[i]; i++)
 	{
-		ftgxCharData* glyphData = NULL;
-		if (this->fontData.find(text[i]) != this->fontData.end())
-		{
-			glyphData = &this->fontData[text[i]];
-		}
-		else
+		glyphData = this->getGlyphData(text[i]);
+
+		if(glyphData != NULL)
 		{
-			glyphData = this->cacheGlyphData(text[i]);
+			if(glyphData->textureWidth)
+				pageGlyphs[glyphData->atlasPage]++;
+			++printed;
 		}
+	}
 
-		if (glyphData != NULL)
+	if(this->atlasDirty)
+	{
+		GX_InvalidateTexAll();
+		this->atlasDirty = false;
+	}
+
+	GX_SetTevOp (GX_TEVSTAGE0, GX_MODULATE);
+	GX_SetVtxDesc (GX_VA_TEX0, GX_DIRECT);
+
+	// one texture load and one batch of quads per page, usually just one
+	for(uint8_t page = 0; page < this->atlasPageCount; page++)
+	{
+		if(pageGlyphs[page] == 0)
+			continue;
+
+		GX_LoadTexObj(&this->atlasPages[page].texObj, GX_TEXMAP0);
+		GX_Begin(GX_QUADS, this->vertexIndex, pageGlyphs[page] << 2);
+
+		x_pos = x;
+		prevData = NULL;
+
+		for(i = 0; text[i]; i++)
 		{
-			if (this->ftKerningEnabled && i)
+			glyphData = this->getGlyphData(text[i]);
+
+			if(glyphData == NULL)
+				continue;
+
+			if(this->ftKerningEnabled && prevData != NULL)
 			{
-				FT_Get_Kerning(ftFace, this->fontData[text[i - 1]].glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
+				FT_Get_Kerning(ftFace, prevData->glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
 				x_pos += pairDelta.x >> 6;
 			}
 
-			GX_InitTexObj(&glyphTexture, glyphData->glyphDataTexture, glyphData->textureWidth, glyphData->textureHeight, GX_TF_I4, GX_CLAMP, GX_CLAMP, GX_FALSE);
-			this->copyTextureToFramebuffer(&glyphTexture, glyphData->textureWidth, glyphData->textureHeight, x_pos + glyphData->renderOffsetX + x_offset, y - glyphData->renderOffsetY + y_offset, color);
+			if(glyphData->textureWidth && glyphData->atlasPage == page)
+				this->copyGlyphToFramebuffer(glyphData, x_pos + glyphData->renderOffsetX + x_offset, y - glyphData->renderOffsetY + y_offset, color);
 
 			x_pos += glyphData->glyphAdvanceX;
-			++printed;
+			prevData = glyphData;
 		}
-		++i;
+		GX_End();
 	}
 
+	this->setDefaultMode();
+
 	if(textStyle & FTGX_STYLE_MASK)
 	{
 		this->getOffset(text, &offset);
@@ -492,29 +687,23 @@ uint16_t FreeTypeGX::getWidth(wchar_t *text)
 {
 	uint16_t strWidth = 0;
 	FT_Vector pairDelta;
+	ftgxCharData *prevData = NULL;
 
 	int i = 0;
 	while (text[i])
 	{
-		ftgxCharData* glyphData = NULL;
-		if (this->fontData.find(text[i]) != this->fontData.end())
-		{
-			glyphData = &this->fontData[text[i]];
-		}
-		else
-		{
-			glyphData = this->cacheGlyphData(text[i]);
-		}
+		ftgxCharData* glyphData = this->getGlyphData(text[i]);
 
 		if (glyphData != NULL)
 		{
-			if (this->ftKerningEnabled && (i > 0))
+			if (this->ftKerningEnabled && prevData != NULL)
 			{
-				FT_Get_Kerning(ftFace, this->fontData[text[i - 1]].glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
+				FT_Get_Kerning(ftFace, prevData->glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
 				strWidth += pairDelta.x >> 6;
 			}
 
 			strWidth += glyphData->glyphAdvanceX;
+			prevData = glyphData;
 		}
 		++i;
 	}
@@ -530,6 +719,42 @@ uint16_t FreeTypeGX::getWidth(wchar_t const *text)
 	return this->getWidth((wchar_t *)text);
 }
 
+/**
+ * Processes the supplied string and returns the width of each of its leading substrings.
+ *
+ * This routine measures the whole string in one pass, with the same kerning as getWidth. Callers can then find the
+ * width of any part of the string by subtraction, instead of measuring it again.
+ *
+ * @param text	NULL terminated string to calculate.
+ * @param widths	Array of at least the string length plus one entries. widths[i] is set to the width in pixels of the first i characters.
+ */
+void FreeTypeGX::getWidths(wchar_t *text, int *widths)
+{
+	int strWidth = 0;
+	FT_Vector pairDelta;
+	ftgxCharData *prevData = NULL;
+
+	int i = 0;
+	widths[0] = 0;
+	while (text[i])
+	{
+		ftgxCharData* glyphData = this->getGlyphData(text[i]);
+
+		if (glyphData != NULL)
+		{
+			if (this->ftKerningEnabled && prevData != NULL)
+			{
+				FT_Get_Kerning(ftFace, prevData->glyphIndex, glyphData->glyphIndex, FT_KERNING_DEFAULT, &pairDelta);
+				strWidth += pairDelta.x >> 6;
+			}
+
+			strWidth += glyphData->glyphAdvanceX;
+			prevData = glyphData;
+		}
+		widths[++i] = strWidth;
+	}
+}
+
 /**
  * Processes the supplied string and return the height of the string in pixels.
  *
@@ -572,15 +797,7 @@ void FreeTypeGX::getOffset(wchar_t *text, ftgxDataOffset* offset)
 	int i = 0;
 	while (text[i])
 	{
-		ftgxCharData* glyphData = NULL;
-		if (this->fontData.find(text[i]) != this->fontData.end())
-		{
-			glyphData = &this->fontData[text[i]];
-		}
-		else
-		{
-			glyphData = this->cacheGlyphData(text[i]);
-		}
+		ftgxCharData* glyphData = this->getGlyphData(text[i]);
 
 		if(glyphData != NULL)
 		{
@@ -605,44 +822,41 @@ void FreeTypeGX::getOffset(wchar_t const *text, ftgxDataOffset* offset)
 }
 
 /**
- * Copies the supplied texture quad to the EFB.
+ * Adds a glyph quad to the current vertex batch.
  *
- * This routine uses the in-built GX quad builder functions to define the texture bounds and location on the EFB target.
+ * This routine emits the four vertices of the glyph's cell in the atlas. It must be called between GX_Begin and GX_End,
+ * with the glyph's atlas page loaded.
  *
- * @param texObj	A pointer to the glyph's initialized texture object.
- * @param texWidth	The pixel width of the texture object.
- * @param texHeight	The pixel height of the texture object.
- * @param screenX	The screen X coordinate at which to output the rendered texture.
- * @param screenY	The screen Y coordinate at which to output the rendered texture.
- * @param color	Color to apply to the texture.
+ * @param charData	A pointer to the glyph's font structure.
+ * @param screenX	The screen X coordinate at which to output the glyph.
+ * @param screenY	The screen Y coordinate at which to output the glyph.
+ * @param color	Color to apply to the glyph.
  */
-void FreeTypeGX::copyTextureToFramebuffer(GXTexObj *texObj, f32 texWidth, f32 texHeight, int16_t screenX, int16_t screenY, GXColor color)
+void FreeTypeGX::copyGlyphToFramebuffer(ftgxCharData *charData, int16_t screenX, int16_t screenY, GXColor color)
 {
-	GX_LoadTexObj(texObj, GX_TEXMAP0);
-	GX_InvalidateTexAll();
-
-	GX_SetTevOp (GX_TEVSTAGE0, GX_MODULATE);
-	GX_SetVtxDesc (GX_VA_TEX0, GX_DIRECT);
+	f32 scale = 1.0f / this->atlasSize;
+	f32 s0 = charData->atlasX * scale;
+	f32 t0 = charData->atlasY * scale;
+	f32 s1 = (charData->atlasX + charData->textureWidth) * scale;
+	f32 t1 = (charData->atlasY + charData->textureHeight) * scale;
+	int16_t width = charData->textureWidth;
+	int16_t height = charData->textureHeight;
 
-	GX_Begin(GX_QUADS, this->vertexIndex, 4);
 	GX_Position2s16(screenX, screenY);
 	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(0.0f, 0.0f);
+	GX_TexCoord2f32(s0, t0);
 
-	GX_Position2s16(texWidth + screenX, screenY);
+	GX_Position2s16(width + screenX, screenY);
 	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(1.0f, 0.0f);
+	GX_TexCoord2f32(s1, t0);
 
-	GX_Position2s16(texWidth + screenX, texHeight + screenY);
+	GX_Position2s16(width + screenX, height + screenY);
 	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(1.0f, 1.0f);
+	GX_TexCoord2f32(s1, t1);
 
-	GX_Position2s16(screenX, texHeight + screenY);
+	GX_Position2s16(screenX, height + screenY);
 	GX_Color4u8(color.r, color.g, color.b, color.a);
-	GX_TexCoord2f32(0.0f, 1.0f);
-	GX_End();
-
-	this->setDefaultMode();
+	GX_TexCoord2f32(s0, t1);
 }
 
 /**
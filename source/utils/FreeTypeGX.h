@@ -35,6 +35,8 @@
 
 #define MAX_FONT_SIZE 100
 
+#define FTGX_ATLAS_PAGES	16	/**< Maximum number of glyph atlas pages per font size. */
+
 /*! \struct ftgxCharData_
  *
  * Font face character glyph relevant data structure.
@@ -51,9 +53,25 @@ typedef struct ftgxCharData_ {
 	int16_t renderOffsetMax;	/**< Texture Y axis bearing maximum value. */
 	int16_t renderOffsetMin;	/**< Texture Y axis bearing minimum value. */
 
-	uint8_t* glyphDataTexture;	/**< Glyph texture bitmap data buffer. */
+	uint16_t atlasX;			/**< X position of the glyph bitmap in its atlas page. */
+	uint16_t atlasY;			/**< Y position of the glyph bitmap in its atlas page. */
+	uint8_t atlasPage;			/**< Atlas page holding the glyph bitmap. */
+	uint8_t cached;				/**< Glyph state, one of the FTGX_GLYPH_* values. */
 } ftgxCharData;
 
+#define FTGX_GLYPH_NONE		0	/**< Glyph has not been looked up yet. */
+#define FTGX_GLYPH_LOADED	1	/**< Glyph is loaded. A textureWidth of 0 means it has no bitmap. */
+#define FTGX_GLYPH_MISSING	2	/**< Glyph is not in the font face. */
+
+/*! \struct ftgxAtlasPage_
+ *
+ * Texture page which glyph bitmaps are packed into.
+ */
+typedef struct ftgxAtlasPage_ {
+	uint8_t* texture;	/**< I4 texture data buffer. */
+	GXTexObj texObj;	/**< Texture object for the page. */
+} ftgxAtlasPage;
+
 /*! \struct ftgxDataOffset_
  *
  * Offset structure which hold both a maximum and minimum value.
@@ -128,7 +146,17 @@ class FreeTypeGX {
 		bool ftKerningEnabled;	/**< Flag indicating the availability of font kerning data. */
 		uint8_t vertexIndex;	/**< Vertex format descriptor index. */
 		uint32_t compatibilityMode;	/**< Compatibility mode for default tev operations and vertex descriptors. */
-		std::map<wchar_t, ftgxCharData> fontData; /**< Map which holds the glyph data structures for the corresponding characters. */
+		ftgxCharData *glyphTable[256];	/**< Glyph data structures for the Basic Multilingual Plane, in blocks of 256 characters. */
+		std::map<wchar_t, ftgxCharData> fontData; /**< Map which holds the glyph data structures for characters outside the Basic Multilingual Plane. */
+
+		ftgxAtlasPage atlasPages[FTGX_ATLAS_PAGES];	/**< Texture pages holding the glyph bitmaps. */
+		uint8_t atlasPageCount;	/**< Number of allocated atlas pages. */
+		uint16_t atlasSize;		/**< Width and height of each atlas page in pixels. */
+		uint16_t shelfX;		/**< Next free X position on the current shelf of the last page. */
+		uint16_t shelfY;		/**< Y position of the current shelf of the last page. */
+		uint16_t shelfHeight;	/**< Height of the current shelf of the last page. */
+		bool atlasDirty;		/**< Flag indicating glyphs were added since the texture cache was last invalidated. */
+		bool atlasFull;			/**< Flag indicating a glyph did not fit, so the atlas is emptied before the next string is drawn. */
 
 		static uint16_t adjustTextureWidth(uint16_t textureWidth);
 		static uint16_t adjustTextureHeight(uint16_t textureHeight);
@@ -137,14 +165,17 @@ class FreeTypeGX {
 		static int16_t getStyleOffsetHeight(ftgxDataOffset *offset, uint16_t format);
 
 		void unloadFont();
-		ftgxCharData *cacheGlyphData(wchar_t charCode);
+		ftgxCharData *getGlyphData(wchar_t charCode);
+		ftgxCharData *cacheGlyphData(wchar_t charCode, ftgxCharData *charData);
 		uint16_t cacheGlyphDataComplete();
+		bool allocGlyphSpace(ftgxCharData *charData);
+		void resetAtlas();
 		void loadGlyphData(FT_Bitmap *bmp, ftgxCharData *charData);
 
 		void setDefaultMode();
 
 		void drawTextFeature(int16_t x, int16_t y, uint16_t width, ftgxDataOffset *offsetData, uint16_t format, GXColor color);
-		void copyTextureToFramebuffer(GXTexObj *texObj, f32 texWidth, f32 texHeight, int16_t screenX, int16_t screenY, GXColor color);
+		void copyGlyphToFramebuffer(ftgxCharData *charData, int16_t screenX, int16_t screenY, GXColor color);
 		void copyFeatureToFramebuffer(f32 featureWidth, f32 featureHeight, int16_t screenX, int16_t screenY,  GXColor color);
 
 	public:
@@ -159,6 +190,7 @@ class FreeTypeGX {
 
 		uint16_t getWidth(wchar_t *text);
 		uint16_t getWidth(wchar_t const *text);
+		void getWidths(wchar_t *text, int *widths);
 		uint16_t getHeight(wchar_t *text);
 		uint16_t getHeight(wchar_t const *text);
 		void getOffset(wchar_t *text, ftgxDataOffset* offset);
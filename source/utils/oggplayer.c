@@ -36,9 +36,20 @@
 #include <gccore.h>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
 
 #include "oggplayer.h"
 
+/* device leases for PlayOggFile, in fileop.cpp */
+int FindFileDevice(const char *filepath);
+void AcquireFileDevice(int device);
+void ReleaseFileDevice(int device);
+
+/* The device of the file being streamed is only leased around each read,
+ * seek and close, so the device thread can still notice it being removed
+ * between reads. */
+static int ogg_file_device = -1;
+
 /* functions to read the Ogg file from memory */
 
 static struct
@@ -79,7 +90,11 @@ static int f_read(void * punt, int bytes, int blocks, int *f)
 			}
 		}
 		else
+		{
+			AcquireFileDevice(ogg_file_device);
 			b = read(*f, ((char *) punt) + c, b);
+			ReleaseFileDevice(ogg_file_device);
+		}
 
 		if (b <= 0)
 		{
@@ -155,7 +170,11 @@ static int f_seek(int *f, ogg_int64_t offset, int mode)
 
 	}
 	else
+	{
+		AcquireFileDevice(ogg_file_device);
 		k = lseek(*f, (int) offset, mode);
+		ReleaseFileDevice(ogg_file_device);
+	}
 
 	if (k < 0)
 		k = -1;
@@ -178,7 +197,12 @@ static int f_close(int *f)
 		return 0;
 	}
 	else
-		return close(*f);
+	{
+		AcquireFileDevice(ogg_file_device);
+		int k = close(*f);
+		ReleaseFileDevice(ogg_file_device);
+		return k;
+	}
 	return 0;
 }
 
@@ -448,20 +472,11 @@ void StopOgg()
 		LWP_CloseQueue(oggplayer_queue);
 		oggplayer_queue = LWP_TQUEUE_NULL;
 	}
+	ogg_file_device = -1;
 }
 
-int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
+static int StartOgg(int time_pos, int mode)
 {
-	StopOgg();
-
-	private_ogg.fd = mem_open((char *)buffer, len);
-	
-	if (private_ogg.fd < 0)
-	{
-		private_ogg.fd = -1;
-		return -1;
-	}
-	
 	private_ogg.mode = mode;
 	private_ogg.eof = 0;
 	private_ogg.volume = 127;
@@ -490,6 +505,43 @@ int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
 	return 0;
 }
 
+int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
+{
+	StopOgg();
+
+	private_ogg.fd = mem_open((char *)buffer, len);
+
+	if (private_ogg.fd < 0)
+	{
+		private_ogg.fd = -1;
+		return -1;
+	}
+
+	return StartOgg(time_pos, mode);
+}
+
+int PlayOggFile(const char *filepath, int time_pos, int mode)
+{
+	StopOgg();
+
+	/* The player thread reads at most 4KB per read() and only when a PCM
+	 * buffer needs refilling (every ~90ms at 44.1KHz), so a ROM load from
+	 * the same device waits on at most one such read at a time. */
+	ogg_file_device = FindFileDevice(filepath);
+
+	AcquireFileDevice(ogg_file_device);
+	private_ogg.fd = open(filepath, O_RDONLY);
+	ReleaseFileDevice(ogg_file_device);
+
+	if (private_ogg.fd < 0 || StartOgg(time_pos, mode) < 0)
+	{
+		private_ogg.fd = -1;
+		ogg_file_device = -1;
+		return -1;
+	}
+	return 0;
+}
+
 void PauseOgg(int pause)
 {
 	if (pause)
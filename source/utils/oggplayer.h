@@ -56,6 +56,17 @@ extern "C"
  ***************************************************************************/
 int PlayOgg(const void *buffer, s32 len, int time_pos, int mode);
 
+/****************************************************************************
+ * PlayOggFile
+ *
+ * Like PlayOgg, but the Ogg data is read from the file as it is decoded
+ * filepath - path of the Ogg file
+ * time_pos - initial time position at which to start playback
+ * mode - playback mode (OGG_ONE_TIME or OGG_INFINITE_TIME)
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int PlayOggFile(const char *filepath, int time_pos, int mode);
+
 /****************************************************************************
  * StopOgg
  *
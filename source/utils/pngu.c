@@ -650,6 +650,34 @@ u8 * DecodePNGFromFile(const char *filepath, int * width, int * height, u8 *dstP
 	return dst;
 }
 
+/* Like DecodePNGFromFile, but allocates the result and scales the image down
+   to fit scalewidth x scaleheight */
+u8 * DecodePNGFromFileScaled(const char *filepath, int * width, int * height, int maxwidth, int maxheight, int scalewidth, int scaleheight)
+{
+	FILE *file = fopen (filepath, "rb");
+
+	if (!file)
+		return NULL;
+
+	IMGCTX ctx = PNGU_SelectImageFromDevice(filepath);
+
+	if(!ctx)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	ctx->fd = file;
+	PNGUPROP imgProp;
+	u8 *dst = NULL;
+
+	if(PNGU_GetImageProperties(ctx, &imgProp) == PNGU_OK && imgProp.imgWidth <= maxwidth && imgProp.imgHeight <= maxheight)
+		dst = PNGU_DecodeTo4x4RGBA8 (ctx, imgProp.imgWidth, imgProp.imgHeight, width, height, NULL, scalewidth, scaleheight);
+
+	PNGU_ReleaseImageContext (ctx);
+	return dst;
+}
+
 int PNGU_EncodeFromRGB (IMGCTX ctx, u32 width, u32 height, void *buffer, u32 stride)
 {
 	png_uint_32 rowbytes;
@@ -706,6 +734,9 @@ int PNGU_EncodeFromRGB (IMGCTX ctx, u32 width, u32 height, void *buffer, u32 str
     png_set_IHDR (ctx->png_ptr, ctx->info_ptr, width, height, 8, PNG_COLOR_TYPE_RGB, 
 				PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
+	// Screenshots and borders are small, favour encoding speed
+	png_set_compression_level (ctx->png_ptr, Z_BEST_SPEED);
+
 	// Allocate memory to store the image in RGB format
 	rowbytes = width * 3;
 	if (rowbytes % 4)
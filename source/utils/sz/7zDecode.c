@@ -154,9 +154,72 @@ SZ_RESULT SzDecode(const CFileSize *packSizes, const CFolder *folder,
 }
 
 #ifdef _LZMA_OUT_READ
+// decoder state of the last solid block, so that extracting a later file
+// of the same block continues from where the last extraction stopped
+typedef struct _CSzDecodeCache
+{
+  int Valid;
+  CFileSize PackPos;    // stream position of the block, identifies it
+  size_t UnPackSize;
+  size_t InSize;
+  CLzmaDecoderState State;
+  size_t Pos;           // bytes of the block decoded so far
+  size_t InRemaining;   // packed bytes not yet read from the stream
+  Byte *InBuffer;       // packed bytes read but not yet decoded
+  void (*Free)(void *address);
+} CSzDecodeCache;
+
+static CSzDecodeCache g_DecodeCache = { 0 };
+
+void SzDecodeCacheFree()
+{
+  CSzDecodeCache *c = &g_DecodeCache;
+  if (c->Free != 0)
+  {
+    c->Free(c->State.Probs);
+    c->Free(c->State.Dictionary);
+    c->Free(c->InBuffer);
+  }
+  memset(c, 0, sizeof(CSzDecodeCache));
+}
+
+static SZ_RESULT SzDecodeCacheInit(const CFolder *folder, CFileSize packPos,
+    size_t inSize, size_t outSize, ISzAlloc *allocMain)
+{
+  CSzDecodeCache *c = &g_DecodeCache;
+  CCoderInfo *coder = folder->Coders;
+
+  SzDecodeCacheFree();
+  c->Free = allocMain->Free;
+
+  if (LzmaDecodeProperties(&c->State.Properties, coder->Properties.Items,
+      coder->Properties.Capacity) != LZMA_RESULT_OK)
+    return SZE_FAIL;
+
+  c->State.Probs = (CProb *)allocMain->Alloc(LzmaGetNumProbs(&c->State.Properties) * sizeof(CProb));
+  if (c->State.Probs == 0)
+    return SZE_OUTOFMEMORY;
+
+  if (c->State.Properties.DictionarySize != 0)
+  {
+    c->State.Dictionary = (unsigned char *)allocMain->Alloc(c->State.Properties.DictionarySize);
+    if (c->State.Dictionary == 0)
+      return SZE_OUTOFMEMORYDIC;
+  }
+  LzmaDecoderInit(&c->State);
+
+  c->PackPos = packPos;
+  c->UnPackSize = outSize;
+  c->InSize = inSize;
+  c->InRemaining = inSize;
+  c->Pos = 0;
+  c->Valid = 1;
+  return SZ_OK;
+}
+
 // like SzDecode but uses less memory
 SZ_RESULT SzDecode2(const CFileSize *packSizes, const CFolder *folder,
-    ISzInStream *inStream,
+    ISzInStream *inStream, CFileSize packPos,
     Byte *outBuffer, size_t outSize,
     size_t *outSizeProcessed, ISzAlloc *allocMain,
 	size_t *fileOffset, size_t *fileSize)
@@ -204,158 +267,109 @@ SZ_RESULT SzDecode2(const CFileSize *packSizes, const CFolder *folder,
 
   if (AreMethodsEqual(&coder->MethodID, &k_LZMA))
   {
-    #ifdef _LZMA_IN_CB
+    CSzDecodeCache *c = &g_DecodeCache;
     CLzmaInCallbackImp lzmaCallback;
-    #else
-    SizeT inProcessed;
-    #endif
-
-    CLzmaDecoderState state;  /* it's about 24-80 bytes structure, if int is 32-bit */
-    int result;
     SizeT outSizeProcessedLoc;
+    size_t copyDone = 0;
+    size_t left;
+    Byte *inBuffer;
+    int result;
 
-    #ifdef _LZMA_IN_CB
-    lzmaCallback.Size = inSize;
-    lzmaCallback.InStream = inStream;
-    lzmaCallback.InCallback.Read = LzmaReadImp;
-    #endif
-
-    if (LzmaDecodeProperties(&state.Properties, coder->Properties.Items,
-        coder->Properties.Capacity) != LZMA_RESULT_OK)
-      return SZE_FAIL;
-
-    state.Probs = (CProb *)allocMain->Alloc(LzmaGetNumProbs(&state.Properties) * sizeof(CProb));
-    if (state.Probs == 0)
-      return SZE_OUTOFMEMORY;
-
-    if (state.Properties.DictionarySize == 0)
-      state.Dictionary = 0;
+    if (c->Valid && c->PackPos == packPos && c->UnPackSize == outSize &&
+        c->InSize == inSize && c->Pos <= *fileOffset)
+    {
+      // continue from the end of the last extraction
+      RINOK(inStream->Seek(inStream, packPos + (inSize - c->InRemaining)));
+    }
     else
     {
-      state.Dictionary = (unsigned char *)allocMain->Alloc(state.Properties.DictionarySize);
-      if (state.Dictionary == 0)
+      SZ_RESULT res = SzDecodeCacheInit(folder, packPos, inSize, outSize, allocMain);
+      if (res != SZ_OK)
       {
-        allocMain->Free(state.Probs);
-        return SZE_OUTOFMEMORYDIC;
+        SzDecodeCacheFree();
+        return res;
       }
     }
-    LzmaDecoderInit(&state);
 
-    // allocate memory for the temporary buffer
-    Byte *tmpBuffer = (Byte *)allocMain->Alloc(_LZMA_TEMP_BUFFER_SIZE);
+    lzmaCallback.Size = c->InRemaining;
+    lzmaCallback.InStream = inStream;
+    lzmaCallback.InCallback.Read = LzmaReadImp;
 
-    // variables containing the number of the first and the last bytes of the buffer
-        size_t bufferStart, bufferEnd;
-        bufferStart = bufferEnd = 0;
+    // decode up to the start of the file, discarding the output
+    if (c->Pos < *fileOffset)
+    {
+      Byte *tmpBuffer = (Byte *)allocMain->Alloc(_LZMA_TEMP_BUFFER_SIZE);
+      if (tmpBuffer == 0)
+      {
+        SzDecodeCacheFree();
+        return SZE_OUTOFMEMORY;
+      }
 
-        // integers contains the offset, the size and the already copied data which will be
-        // copied from the tmpBuffer to outBuffer
-        size_t copyOffset, copySize, copyDone;
-        copyOffset = copySize = copyDone = 0;
+      while (c->Pos < *fileOffset)
+      {
+        size_t step = *fileOffset - c->Pos;
+        if (step > _LZMA_TEMP_BUFFER_SIZE)
+          step = _LZMA_TEMP_BUFFER_SIZE;
 
-        UInt32 i = 0;
-    	int bytesToCopy = 0;
+        result = LzmaDecode(&c->State, &lzmaCallback.InCallback,
+            tmpBuffer, step, &outSizeProcessedLoc);
 
-        // decompress data in _LZMA_TEMP_BUFFER_SIZE byte steps and copy the wanted file to outBuffer
-        do
+        if (result != LZMA_RESULT_OK || outSizeProcessedLoc == 0)
         {
-    		if((*fileSize - copyDone) >= _LZMA_TEMP_BUFFER_SIZE)
-    			bytesToCopy = _LZMA_TEMP_BUFFER_SIZE;
-    		else
-    			bytesToCopy = (*fileSize - copyDone);
-
-    		// decompress next bytes
-    		result = LzmaDecode(&state,
-           	                    #ifdef _LZMA_IN_CB
-           	                    &lzmaCallback.InCallback,
-                    	        #else
-           	                    //inBuffer, (SizeT)inSize, &inProcessed, //TODO!
-                    	        #endif
-                    	        tmpBuffer, bytesToCopy, &outSizeProcessedLoc
-                    	        );
-
-            // check result
-    		if(result == LZMA_RESULT_DATA_ERROR)
-    		{
-    			return SZE_DATA_ERROR;
-    		}
-    		if(result != LZMA_RESULT_OK)
-    		{
-    			return SZE_FAIL;
-    		}
-
-    		// normally this should never happen
-    		if(outSizeProcessedLoc > _LZMA_TEMP_BUFFER_SIZE)
-    		{
-    			return SZE_FAIL;
-    		}
-
-    		// update bufferStart and bufferEnd
-    		bufferStart = _LZMA_TEMP_BUFFER_SIZE * i;
-    		bufferEnd = bufferStart + outSizeProcessedLoc;
-    		i++;
-
-    		// calculate copy offset and size
-    		if(*fileOffset > bufferEnd)
-    		{
-    			// we haven't reached the start of the file yet
-    			continue;
-    		}
-
-    		// calculate offset
-    		if(*fileOffset < bufferStart)
-    		{
-    			// the file has already started before this decompression step
-    			copyOffset = 0;
-    		}
-    		else
-    		{
-    			// the file starts somewhere inside this buffer
-    			copyDone = 0;
-    			copyOffset = _LZMA_TEMP_BUFFER_SIZE - (bufferEnd - *fileOffset);
-    		}
-
-    		// calculate size
-    		if((*fileOffset + *fileSize) > bufferEnd)
-    		{
-    			// we'll need the whole buffer after copyOffset
-    			copySize = _LZMA_TEMP_BUFFER_SIZE - copyOffset;
-    		}
-    		else
-    		{
-    			// we'll stop somewhere inside the buffer
-    			copySize = (*fileOffset + *fileSize) - (bufferStart + copyOffset);
-    		}
-
-    		// copy bytes to the real output buffer
-    		if(copySize == 0)
-    		{
-    			continue;
-    		}
-    	//	printf("memcpy(outBuffer + %d, tmpBuffer + %d, %d)\n", copyDone, copyOffset, copySize);
-    		memcpy(outBuffer + copyDone, tmpBuffer + copyOffset, copySize);
-    		copyDone += copySize;
-    	}
-        while((*fileOffset + *fileSize) > bufferEnd);
-
-    /*    result = LzmaDecode(&state,
-            #ifdef _LZMA_IN_CB
-            &lzmaCallback.InCallback,
-            #else
-            inBuffer, (SizeT)inSize, &inProcessed,
-            #endif
-            outBuffer, (SizeT)outSize, &outSizeProcessedLoc);*/
-        //*outSizeProcessed = (size_t)outSizeProcessedLoc;
-        *outSizeProcessed = copyDone;
-        allocMain->Free(tmpBuffer); // free the temporary buffer again
-        allocMain->Free(state.Probs);
-        allocMain->Free(state.Dictionary);
-    /*    if (result == LZMA_RESULT_DATA_ERROR)
-          return SZE_DATA_ERROR;
-        if (result != LZMA_RESULT_OK)
-          return SZE_FAIL;*/
+          allocMain->Free(tmpBuffer);
+          SzDecodeCacheFree();
+          return result == LZMA_RESULT_OK || result == LZMA_RESULT_DATA_ERROR ?
+              SZE_DATA_ERROR : SZE_FAIL;
+        }
+        c->Pos += outSizeProcessedLoc;
+      }
+      allocMain->Free(tmpBuffer);
+    }
+
+    // decode the file straight into the output buffer
+    while (copyDone < *fileSize)
+    {
+      result = LzmaDecode(&c->State, &lzmaCallback.InCallback,
+          outBuffer + copyDone, *fileSize - copyDone, &outSizeProcessedLoc);
+
+      if (result != LZMA_RESULT_OK || outSizeProcessedLoc == 0)
+      {
+        SzDecodeCacheFree();
+        return result == LZMA_RESULT_OK || result == LZMA_RESULT_DATA_ERROR ?
+            SZE_DATA_ERROR : SZE_FAIL;
+      }
+      copyDone += outSizeProcessedLoc;
+      c->Pos += outSizeProcessedLoc;
+    }
+    *outSizeProcessed = copyDone;
+
+    // only keep the decoder if it is small enough and more of the block remains
+    if (c->State.Properties.DictionarySize > _SZ_CACHE_MAX_DICTIONARY || c->Pos >= outSize)
+    {
+      SzDecodeCacheFree();
+      return SZ_OK;
+    }
+
+    // the stream's buffer will be reused, so keep the unread input
+    c->InRemaining = lzmaCallback.Size;
+    left = c->State.BufferLim - c->State.Buffer;
+    inBuffer = 0;
+    if (left > 0)
+    {
+      inBuffer = (Byte *)allocMain->Alloc(left);
+      if (inBuffer == 0)
+      {
+        SzDecodeCacheFree();
         return SZ_OK;
       }
-      return SZE_NOTIMPL;
+      memcpy(inBuffer, c->State.Buffer, left);
     }
-    #endif
+    allocMain->Free(c->InBuffer);
+    c->InBuffer = inBuffer;
+    c->State.Buffer = inBuffer;
+    c->State.BufferLim = inBuffer + left;
+    return SZ_OK;
+  }
+  return SZE_NOTIMPL;
+}
+#endif
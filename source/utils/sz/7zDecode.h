@@ -24,14 +24,19 @@ SZ_RESULT SzDecode(const CFileSize *packSizes, const CFolder *folder,
 
 #ifdef _LZMA_OUT_READ
 #ifndef _LZMA_TEMP_BUFFER_SIZE
-#define _LZMA_TEMP_BUFFER_SIZE (2048) // size of the temporary buffer in bytes
+#define _LZMA_TEMP_BUFFER_SIZE (64*1024) // size of the temporary buffer in bytes
+#endif
+#ifndef _SZ_CACHE_MAX_DICTIONARY
+#define _SZ_CACHE_MAX_DICTIONARY (16*1024*1024) // largest decoder kept between extractions
 #endif
 
 SZ_RESULT SzDecode2(const CFileSize *packSizes, const CFolder *folder,
-    ISzInStream *stream,
+    ISzInStream *stream, CFileSize packPos,
     Byte *outBuffer, size_t outSize,
     size_t *outSizeProcessed, ISzAlloc *allocMain,
 	size_t *fileOffset, size_t *fileSize);
+
+void SzDecodeCacheFree();
 #endif // #ifdef _LZMA_OUT_READ
 
 #endif
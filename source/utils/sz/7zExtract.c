@@ -197,7 +197,7 @@ SZ_RESULT SzExtract2(
         res = SzDecode2(db->Database.PackSizes +
           db->FolderStartPackStreamIndex[folderIndex], folder,
           #ifdef _LZMA_IN_CB
-          inStream,
+          inStream, SzArDbGetFolderStreamPos(db, folderIndex, 0),
           #else
           inBuffer,
           #endif
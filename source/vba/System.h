@@ -65,6 +65,7 @@ extern void systemMessage(int, const char *, ...);
 extern void systemSetTitle(const char *);
 extern SoundDriver * systemSoundInit();
 extern void systemOnWriteDataToSoundBuffer(const u16 * finalWave, int length);
+extern void systemOnWriteChannelToSoundBuffer(int channel, const u16 * finalWave, int length);
 extern void systemOnSoundShutdown();
 extern void systemScreenMessage(const char *);
 extern void systemUpdateMotionSensor();
@@ -96,12 +97,52 @@ extern int systemRedShift;
 extern int systemGreenShift;
 extern int systemBlueShift;
 extern int systemColorDepth;
+// when set, 16-bit screen lines are written straight into this RGB565
+// texture as 4x4 tiles, systemTiledScreenWidth pixels wide, instead of pix
+extern u16 *systemTiledScreen;
+extern int systemTiledScreenWidth;
+// set when a line written to systemTiledScreen differed from what was there,
+// cleared by the frontend once it has presented the frame
+extern bool systemScreenChanged;
+// set while systemColorMap16 is the plain BGR555 to RGB565 mapping (no LCD
+// filter or colourising), so lines may be converted without the table
+extern bool systemColorMapDirect;
 extern int systemDebug;
 extern int systemVerbose;
 extern int systemFrameSkip;
 extern int systemSaveUpdateCounter;
 extern int systemSpeed;
 
+// first of the 4 pixels of a tile row at (x, y), x a multiple of 4. The
+// next 4 pixels of the line follow 16 pixels later, in the next tile.
+#define SYSTEM_TILED_PIXEL(x, y) (systemTiledScreen + \
+  (((y) >> 2) * systemTiledScreenWidth << 2) + (((y) & 3) << 2) + ((x) << 2))
+
+// stores color at dest++, or'ing into diff the bits that changed
+#define SYSTEM_TILED_STORE(dest, color, diff) { \
+  u16 c_ = (color); (diff) |= *(dest) ^ c_; *(dest)++ = c_; }
+
+// BGR555 to RGB565 for two pixels packed in one word, without the table
+inline u32 systemColorPair16(u32 pair)
+{
+  return ((pair & 0x001f001f) << 11) | ((pair & 0x03e003e0) << 1) |
+    ((pair >> 10) & 0x001f001f);
+}
+
+// stores 4 BGR555 pixels at dest as RGB565, returning the bits that changed
+inline u16 systemTiledStoreDirect(u16 *dest, u32 p0, u32 p1, u32 p2, u32 p3)
+{
+  u32 a = systemColorPair16((p0 << 16) | (p1 & 0xffff));
+  u32 b = systemColorPair16((p2 << 16) | (p3 & 0xffff));
+  u16 diff = (dest[0] ^ (u16)(a >> 16)) | (dest[1] ^ (u16)a) |
+    (dest[2] ^ (u16)(b >> 16)) | (dest[3] ^ (u16)b);
+  dest[0] = a >> 16;
+  dest[1] = a;
+  dest[2] = b >> 16;
+  dest[3] = b;
+  return diff;
+}
+
 #define SYSTEM_SAVE_UPDATED 30
 #define SYSTEM_SAVE_NOT_UPDATED 0
 
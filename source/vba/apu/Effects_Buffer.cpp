@@ -81,9 +81,8 @@ void Effects_Buffer::delete_bufs()
 
 blargg_err_t Effects_Buffer::set_sample_rate( long rate, int msec )
 {
-	// extra to allow farther past-the-end pointers
+	// echo buffer is allocated by apply_config() once effects are needed
 	mixer.samples_read = 0;
-	RETURN_ERR( echo.resize( echo_size + stereo ) );
 	return Multi_Buffer::set_sample_rate( rate, msec );
 }
 
@@ -324,6 +323,17 @@ void Effects_Buffer::apply_config()
 	if ( !config_.enabled )
 		no_effects = true;
 
+	// mix_effects() always goes through the echo buffer, so it's only
+	// allocated once something other than plain stereo mixing is needed
+	if ( !no_effects && !echo.size() )
+	{
+		// extra to allow farther past-the-end pointers
+		if ( echo.resize( echo_size + stereo ) )
+			no_effects = true;
+		else
+			echo_dirty = true;
+	}
+
 	if ( no_effects )
 	{
 		for ( i = chans.size(); --i >= 0; )
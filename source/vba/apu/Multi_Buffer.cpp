@@ -196,6 +196,142 @@ long Stereo_Buffer::read_samples( blip_sample_t* out, long out_size )
 	return out_size;
 }
 
+void Stereo_Buffer::sum_samples( blargg_long* out, long out_size )
+{
+	out_size = min( out_size, samples_avail() );
+
+	int pair_count = int (out_size >> 1);
+	if ( pair_count )
+		mixer.sum_pairs( out, pair_count );
+}
+
+
+// Split_Buffer
+
+Split_Buffer::Split_Buffer() : Multi_Buffer( 2 )
+{
+	clock_rate_ = 0;
+	bass_freq_  = 16;
+}
+
+Split_Buffer::~Split_Buffer()
+{
+	delete_bufs();
+}
+
+void Split_Buffer::delete_bufs()
+{
+	for ( int i = bufs.size(); --i >= 0; )
+		delete bufs [i];
+	bufs.clear();
+	chan_out.clear();
+	mix_out.clear();
+}
+
+blargg_err_t Split_Buffer::set_channel_count( int count, int const* types )
+{
+	delete_bufs();
+	RETURN_ERR( Multi_Buffer::set_channel_count( count, types ) );
+
+	RETURN_ERR( chan_out.resize( (size_t) count * max_read ) );
+	RETURN_ERR( mix_out.resize( max_read ) );
+	RETURN_ERR( bufs.resize( count ) );
+	for ( int i = 0; i < count; i++ )
+		bufs [i] = 0;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		bufs [i] = BLARGG_NEW Stereo_Buffer;
+		CHECK_ALLOC( bufs [i] );
+		if ( sample_rate() )
+			RETURN_ERR( bufs [i]->set_sample_rate( sample_rate(), length() ) );
+		if ( clock_rate_ )
+			bufs [i]->clock_rate( clock_rate_ );
+		bufs [i]->bass_freq( bass_freq_ );
+	}
+
+	channels_changed();
+	return 0;
+}
+
+blargg_err_t Split_Buffer::set_sample_rate( long rate, int msec )
+{
+	for ( int i = bufs.size(); --i >= 0; )
+		RETURN_ERR( bufs [i]->set_sample_rate( rate, msec ) );
+	return Multi_Buffer::set_sample_rate( rate, msec );
+}
+
+void Split_Buffer::clock_rate( long rate )
+{
+	clock_rate_ = rate;
+	for ( int i = bufs.size(); --i >= 0; )
+		bufs [i]->clock_rate( rate );
+}
+
+void Split_Buffer::bass_freq( int bass )
+{
+	bass_freq_ = bass;
+	for ( int i = bufs.size(); --i >= 0; )
+		bufs [i]->bass_freq( bass );
+}
+
+void Split_Buffer::clear()
+{
+	for ( int i = bufs.size(); --i >= 0; )
+		bufs [i]->clear();
+}
+
+Split_Buffer::channel_t Split_Buffer::channel( int i )
+{
+	require( 0 <= i && i < (int) bufs.size() );
+	return bufs [i]->channel( 0 );
+}
+
+void Split_Buffer::end_frame( blip_time_t time )
+{
+	for ( int i = bufs.size(); --i >= 0; )
+		bufs [i]->end_frame( time );
+}
+
+long Split_Buffer::samples_avail() const
+{
+	// all channels are ended at the same time, so they have the same count
+	return bufs.size() ? bufs [0]->samples_avail() : 0;
+}
+
+blip_sample_t const* Split_Buffer::channel_samples( int i ) const
+{
+	require( 0 <= i && i < (int) bufs.size() );
+	return &chan_out [(size_t) i * max_read];
+}
+
+long Split_Buffer::read_samples( blip_sample_t* out, long out_size )
+{
+	require( (out_size & 1) == 0 ); // must read an even number of samples
+	out_size = min( out_size, samples_avail() );
+	out_size = min( out_size, (long) max_read );
+
+	blargg_long* const mix = mix_out.begin();
+	for ( long n = 0; n < out_size; n++ )
+		mix [n] = 0;
+
+	// mix from the unclamped channels, so it only clips where a single
+	// Stereo_Buffer holding every channel would
+	int const count = bufs.size();
+	for ( int i = 0; i < count; i++ )
+	{
+		bufs [i]->sum_samples( mix, out_size );
+		bufs [i]->read_samples( &chan_out [(size_t) i * max_read], out_size );
+	}
+
+	for ( long n = 0; n < out_size; n++ )
+	{
+		blargg_long s = mix [n];
+		out [n] = (blip_sample_t) s;
+		BLIP_CLAMP( s, out [n] );
+	}
+	return out_size;
+}
 
 // Stereo_Mixer
 
@@ -214,6 +350,38 @@ void Stereo_Mixer::read_pairs( blip_sample_t* out, int count )
 		mix_mono( out, count );
 }
 
+void Stereo_Mixer::sum_pairs( blargg_long* out_, int count )
+{
+	// same reads as read_pairs(), but samples_read isn't advanced and the
+	// reader state isn't stored back
+	bool const sides = (bufs [0]->non_silent() | bufs [1]->non_silent()) != 0;
+	int const bass = BLIP_READER_BASS( *bufs [2] );
+
+	for ( int i = 0; i < stereo; i++ )
+	{
+		BLIP_READER_BEGIN( side,   *bufs [i] );
+		BLIP_READER_BEGIN( center, *bufs [2] );
+
+		BLIP_READER_ADJ_( side,   samples_read + count );
+		BLIP_READER_ADJ_( center, samples_read + count );
+
+		blargg_long* BLIP_RESTRICT out = out_ + count * stereo + i;
+		int offset = -count;
+		do
+		{
+			blargg_long s = BLIP_READER_READ_RAW( center );
+			if ( sides )
+				s += BLIP_READER_READ_RAW( side );
+			s >>= blip_sample_bits - 16;
+			BLIP_READER_NEXT_IDX_( side,   bass, offset );
+			BLIP_READER_NEXT_IDX_( center, bass, offset );
+
+			out [offset * stereo] += s;
+		}
+		while ( ++offset );
+	}
+}
+
 void Stereo_Mixer::mix_mono( blip_sample_t* out_, int count )
 {
 	int const bass = BLIP_READER_BASS( *bufs [2] );
@@ -53,6 +53,10 @@ public:
 	virtual long read_samples( blip_sample_t*, long ) BLARGG_PURE( { return 0; } )
 	virtual long samples_avail() const BLARGG_PURE( { return 0; } )
 
+	// Samples of indexed channel alone from the last read_samples(), or NULL if
+	// buffer only outputs the mix (see Split_Buffer)
+	virtual blip_sample_t const* channel_samples( int ) const { return 0; }
+
 public:
 	BLARGG_DISABLE_NOTHROW
 	void disable_immediate_removal() { immediate_removal_ = false; }
@@ -125,6 +129,10 @@ public:
 
 		Stereo_Mixer() : samples_read( 0 ) { }
 		void read_pairs( blip_sample_t* out, int count );
+
+		// Adds the pairs the next read_pairs() will return to out, before
+		// they are clamped. Doesn't read them.
+		void sum_pairs( blargg_long* out, int count );
 	private:
 		void mix_mono  ( blip_sample_t* out, int pair_count );
 		void mix_stereo( blip_sample_t* out, int pair_count );
@@ -152,6 +160,9 @@ public:
 	long samples_avail() const { return (bufs [0].samples_avail() - mixer.samples_read) * 2; }
 	long read_samples( blip_sample_t*, long );
 
+	// Adds the samples the next read_samples() will return to out, unclamped
+	void sum_samples( blargg_long*, long );
+
 private:
 	enum { bufs_size = 3 };
 	typedef Tracked_Blip_Buffer buf_t;
@@ -161,6 +172,38 @@ private:
 	long samples_avail_;
 };
 
+// Gives each channel its own Stereo_Buffer and outputs their sum, so that the
+// stereo output of each channel is also available through channel_samples().
+// Uses much more memory than Stereo_Buffer; meant for capturing channels.
+class Split_Buffer : public Multi_Buffer {
+public:
+	// Most samples returned by one read_samples() call
+	enum { max_read = 4096 };
+
+public:
+	Split_Buffer();
+	~Split_Buffer();
+	blargg_err_t set_channel_count( int, int const* = 0 );
+	blargg_err_t set_sample_rate( long, int msec = blip_default_length );
+	void clock_rate( long );
+	void bass_freq( int );
+	void clear();
+	channel_t channel( int );
+	void end_frame( blip_time_t );
+
+	long samples_avail() const;
+	long read_samples( blip_sample_t*, long );
+	blip_sample_t const* channel_samples( int ) const;
+
+private:
+	blargg_vector<Stereo_Buffer*> bufs;
+	blargg_vector<blip_sample_t> chan_out; // max_read samples per channel
+	blargg_vector<blargg_long> mix_out; // unclamped sum of the channels
+	long clock_rate_;
+	int bass_freq_;
+	void delete_bufs();
+};
+
 // Silent_Buffer generates no samples, useful where no sound is wanted
 class Silent_Buffer : public Multi_Buffer {
 	channel_t chan;
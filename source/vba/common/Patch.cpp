@@ -103,7 +103,7 @@ static uLong computePatchCRC(MFILE *f, unsigned int size)
   return crc;
 }
 
-bool patchApplyIPS(MFILE *f, u8 **r, int *s)
+bool patchApplyIPS(MFILE *f, u8 **r, int *s, int maxSize)
 {
   // from the IPS spec at http://zerosoft.zophar.net/ips.htm
 
@@ -143,6 +143,21 @@ bool patchApplyIPS(MFILE *f, u8 **r, int *s)
       // check if we need to reallocate our ROM
       if((offset + len) >= size) {
 #ifdef GEKKO
+        if(maxSize) {
+          // fixed buffer: grow in place
+          if(offset + len > maxSize) {
+            result = false;
+            break;
+          }
+        } else {
+          u8 *newRom = (u8 *)realloc(rom, offset + len);
+          if(!newRom) {
+            result = false;
+            break;
+          }
+          rom = newRom;
+        }
+        memset(rom + size, 0, offset + len - size);
         size = offset + len;
 #else
         size *= 2;
@@ -167,7 +182,8 @@ bool patchApplyIPS(MFILE *f, u8 **r, int *s)
   return result;
 }
 
-bool patchApplyUPS(MFILE *f, u8 **rom, int *size)
+// romCRC is the CRC32 of the unpatched ROM, if the caller already knows it
+bool patchApplyUPS(MFILE *f, u8 **rom, int *size, const u32 *romCRC, int maxSize)
 {
   s64 srcCRC, dstCRC, patchCRC;
 
@@ -197,8 +213,12 @@ bool patchApplyUPS(MFILE *f, u8 **rom, int *size)
     return false;
   }
 
-  crc = crc32(0L, Z_NULL, 0);
-  crc = crc32(crc, *rom, *size);
+  if (romCRC) {
+    crc = *romCRC;
+  } else {
+    crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, *rom, *size);
+  }
 
   memfseek(f, 4, MSEEK_SET);
   s64 dataSize;
@@ -219,7 +239,16 @@ bool patchApplyUPS(MFILE *f, u8 **rom, int *size)
     return false;
   }
   if (dataSize > *size) {
-    *rom = (u8*)realloc(*rom, dataSize);
+    if (maxSize) {
+      // fixed buffer: grow in place
+      if (dataSize > maxSize)
+        return false;
+    } else {
+      u8 *newRom = (u8*)realloc(*rom, dataSize);
+      if (!newRom)
+        return false;
+      *rom = newRom;
+    }
     memset(*rom + *size, 0, dataSize - *size);
     *size = dataSize;
   }
@@ -243,6 +272,147 @@ bool patchApplyUPS(MFILE *f, u8 **rom, int *size)
   return true;
 }
 
+// BPS patches build the target from copies of the source, the target so far
+// and literal data. The source is copied aside first, since the target is
+// written over it.
+bool patchApplyBPS(MFILE *f, u8 **rom, int *size, const u32 *romCRC, int maxSize)
+{
+  memfseek(f, 0, MSEEK_END);
+  long int patchSize = memftell(f);
+  if (patchSize < 19) {
+    return false;
+  }
+
+  memfseek(f, 0, MSEEK_SET);
+  if (memfgetc(f) != 'B' || memfgetc(f) != 'P' || memfgetc(f) != 'S' || memfgetc(f) != '1') {
+    return false;
+  }
+
+  memfseek(f, -12, MSEEK_END);
+  s64 srcCRC = readInt4(f);
+  s64 dstCRC = readInt4(f);
+  s64 patchCRC = readInt4(f);
+  if (srcCRC == -1 || dstCRC == -1 || patchCRC == -1) {
+    return false;
+  }
+
+  memfseek(f, 0, MSEEK_SET);
+  u32 crc = computePatchCRC(f, patchSize - 4);
+
+  if (crc != patchCRC) {
+    return false;
+  }
+
+  if (romCRC) {
+    crc = *romCRC;
+  } else {
+    crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, *rom, *size);
+  }
+  if (crc != srcCRC) {
+    return false;
+  }
+
+  memfseek(f, 4, MSEEK_SET);
+  s64 srcSize = readVarPtr(f);
+  s64 dstSize = readVarPtr(f);
+  s64 metaSize = readVarPtr(f);
+  if (srcSize != *size || dstSize <= 0) {
+    return false;
+  }
+  memfseek(f, metaSize, MSEEK_CUR);
+
+  u8 *src = (u8 *)malloc(*size);
+  if (!src) {
+    return false;
+  }
+  memcpy(src, *rom, *size);
+
+  if (dstSize > *size) {
+    if (maxSize) {
+      // fixed buffer: grow in place
+      if (dstSize > maxSize) {
+        free(src);
+        return false;
+      }
+    } else {
+      u8 *newRom = (u8*)realloc(*rom, dstSize);
+      if (!newRom) {
+        free(src);
+        return false;
+      }
+      *rom = newRom;
+    }
+  }
+
+  u8 *dst = *rom;
+  s64 out = 0, srcRel = 0, dstRel = 0;
+  bool ok = true;
+
+  while (ok && memftell(f) < patchSize - 12) {
+    s64 data = readVarPtr(f);
+    s64 len = (data >> 2) + 1;
+    if (out + len > dstSize) {
+      ok = false;
+      break;
+    }
+
+    switch (data & 3) {
+    case 0: // SourceRead
+      if (out + len > srcSize) {
+        ok = false;
+        break;
+      }
+      memcpy(dst + out, src + out, len);
+      out += len;
+      break;
+    case 1: // TargetRead
+      if (memfread(dst + out, 1, len, f) != (size_t)len)
+        ok = false;
+      out += len;
+      break;
+    case 2: // SourceCopy
+      data = readVarPtr(f);
+      srcRel += (data & 1 ? -1 : 1) * (data >> 1);
+      if (srcRel < 0 || srcRel + len > srcSize) {
+        ok = false;
+        break;
+      }
+      memcpy(dst + out, src + srcRel, len);
+      srcRel += len;
+      out += len;
+      break;
+    case 3: // TargetCopy, may overlap the bytes it produces
+      data = readVarPtr(f);
+      dstRel += (data & 1 ? -1 : 1) * (data >> 1);
+      if (dstRel < 0 || dstRel >= out) {
+        ok = false;
+        break;
+      }
+      while (len--)
+        dst[out++] = dst[dstRel++];
+      break;
+    }
+  }
+
+  if (ok && out == dstSize) {
+    crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, dst, dstSize);
+    ok = (crc == dstCRC);
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    // put the unpatched ROM back
+    memcpy(dst, src, *size);
+  } else {
+    *size = dstSize;
+  }
+  free(src);
+  return ok;
+}
+
 static int ppfVersion(MFILE *f)
 {
   memfseek(f, 0, MSEEK_SET);
@@ -435,6 +605,8 @@ bool applyPatch(const char *patchname, u8 **rom, int *size)
         result = patchApplyIPS(mf, rom, size);
     else if (_stricmp(p, ".ups") == 0)
         result = patchApplyUPS(mf, rom, size);
+    else if (_stricmp(p, ".bps") == 0)
+        result = patchApplyBPS(mf, rom, size);
     else if (_stricmp(p, ".ppf") == 0)
         result = patchApplyPPF(mf, rom, size);
 
@@ -5,8 +5,11 @@
 #include "Types.h"
 
 bool applyPatch(const char *patchname, u8 **rom, int *size);
-bool patchApplyIPS(MFILE * f, u8 **r, int *s);
-bool patchApplyUPS(MFILE * f, u8 **rom, int *size);
+// maxSize is the capacity of a ROM buffer that must be patched in place
+// (it can't be reallocated), or 0 if the buffer came from malloc
+bool patchApplyIPS(MFILE * f, u8 **r, int *s, int maxSize = 0);
+bool patchApplyUPS(MFILE * f, u8 **rom, int *size, const u32 *romCRC = NULL, int maxSize = 0);
+bool patchApplyBPS(MFILE * f, u8 **rom, int *size, const u32 *romCRC = NULL, int maxSize = 0);
 bool patchApplyPPF(MFILE *f, u8 **rom, int *size);
 
 #endif // PATCH_H
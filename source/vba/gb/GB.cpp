@@ -4385,6 +4385,30 @@ void gbDrawLine()
   switch(systemColorDepth) {
     case 16:
     {
+      if(systemTiledScreen) {
+        // the LCD-off refresh also draws LY 144, which has no row in the
+        // texture (pix had a padding row for it)
+        if(register_LY >= 144)
+          break;
+        u16 * dest = SYSTEM_TILED_PIXEL(gbBorderColumnSkip,
+                                        register_LY + gbBorderRowSkip);
+        u16 diff = 0;
+        if(systemColorMapDirect) {
+          for(int x = 0; x < 160; x += 4, dest += 16)
+            diff |= systemTiledStoreDirect(dest, gbLineMix[x], gbLineMix[x+1],
+                                           gbLineMix[x+2], gbLineMix[x+3]);
+        } else {
+          for(int x = 0; x < 160; dest += 12) {
+            SYSTEM_TILED_STORE(dest, systemColorMap16[gbLineMix[x++]], diff);
+            SYSTEM_TILED_STORE(dest, systemColorMap16[gbLineMix[x++]], diff);
+            SYSTEM_TILED_STORE(dest, systemColorMap16[gbLineMix[x++]], diff);
+            SYSTEM_TILED_STORE(dest, systemColorMap16[gbLineMix[x++]], diff);
+          }
+        }
+        if(diff)
+          systemScreenChanged = true;
+        break;
+      }
       u16 * dest = (u16 *)pix +
                    (gbBorderLineSkip+2) * (register_LY + gbBorderRowSkip)
                    + gbBorderColumnSkip;
@@ -113,6 +113,19 @@ void gbSgbFillScreen(u16 color)
   switch(systemColorDepth) {
   case 16:
     {
+      if(systemTiledScreen) {
+        systemScreenChanged = true;
+        for(int y = 0; y < 144; y++) {
+          u16 *dest = SYSTEM_TILED_PIXEL(gbBorderColumnSkip, y + gbBorderRowSkip);
+          for(int x = 0; x < 160; x += 4, dest += 12) {
+            gbSgbDraw16Bit(dest++, color);
+            gbSgbDraw16Bit(dest++, color);
+            gbSgbDraw16Bit(dest++, color);
+            gbSgbDraw16Bit(dest++, color);
+          }
+        }
+        break;
+      }
       for(int y = 0; y < 144; y++) {
         int yLine = (y+gbBorderRowSkip+1)*(gbBorderLineSkip+2) +
           gbBorderColumnSkip;
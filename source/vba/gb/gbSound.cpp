@@ -14,7 +14,9 @@ extern long soundSampleRate; // current sound quality
 gb_effects_config_t gb_effects_config = { false, 0.20f, 0.15f, false };
 
 static gb_effects_config_t    gb_effects_config_current;
-static Simple_Effects_Buffer* stereo_buffer;
+static Multi_Buffer*          stereo_buffer;
+static Simple_Effects_Buffer* effects_buffer; // 0 when effects are bypassed
+static bool                   split_channels_;
 static Gb_Apu*                gb_apu;
 
 static float soundVolume_  = -1;
@@ -51,16 +53,30 @@ static void end_frame( blip_time_t time )
 	stereo_buffer->end_frame( time );
 }
 
+static void remake_stereo_buffer();
+
 static void apply_effects()
 {
+	// Buffer type depends on channel capture and on whether effects are
+	// enabled, since Effects_Buffer is bypassed when they aren't
+	if ( split_channels_ != soundSplitChannels ||
+			(!split_channels_ && gb_effects_config.enabled != (effects_buffer != 0)) )
+	{
+		remake_stereo_buffer();
+		return;
+	}
+
 	prevSoundEnable = soundGetEnable();
 	gb_effects_config_current = gb_effects_config;
 
-	stereo_buffer->config().enabled  = gb_effects_config_current.enabled;
-	stereo_buffer->config().echo     = gb_effects_config_current.echo;
-	stereo_buffer->config().stereo   = gb_effects_config_current.stereo;
-	stereo_buffer->config().surround = gb_effects_config_current.surround;
-	stereo_buffer->apply_config();
+	if ( effects_buffer )
+	{
+		effects_buffer->config().enabled  = gb_effects_config_current.enabled;
+		effects_buffer->config().echo     = gb_effects_config_current.echo;
+		effects_buffer->config().stereo   = gb_effects_config_current.stereo;
+		effects_buffer->config().surround = gb_effects_config_current.surround;
+		effects_buffer->apply_config();
+	}
 
 	for ( int i = 0; i < chan_count; i++ )
 	{
@@ -95,7 +111,8 @@ void gbSoundTick()
 
 		// Update effects config if it was changed
 		if ( memcmp( &gb_effects_config_current, &gb_effects_config,
-				sizeof gb_effects_config ) || soundGetEnable() != prevSoundEnable )
+				sizeof gb_effects_config ) || soundGetEnable() != prevSoundEnable ||
+				split_channels_ != soundSplitChannels )
 			apply_effects();
 
 		if ( soundVolume_ != soundGetVolume() )
@@ -130,9 +147,17 @@ static void remake_stereo_buffer()
 
 	// Stereo_Buffer
 	delete stereo_buffer;
-	stereo_buffer = 0;
-
-	stereo_buffer = new Simple_Effects_Buffer; // TODO: handle out of memory
+	stereo_buffer  = 0;
+	effects_buffer = 0;
+
+	// Channel capture takes priority over effects
+	split_channels_ = soundSplitChannels;
+	if ( split_channels_ )
+		stereo_buffer = new Split_Buffer; // TODO: handle out of memory
+	else if ( gb_effects_config.enabled )
+		stereo_buffer = effects_buffer = new Simple_Effects_Buffer; // TODO: handle out of memory
+	else
+		stereo_buffer = new Stereo_Buffer; // TODO: handle out of memory
 	if ( stereo_buffer->set_sample_rate( soundSampleRate ) ) { } // TODO: handle out of memory
 	stereo_buffer->clock_rate( gb_apu->clock_rate );
 	
@@ -2207,6 +2207,116 @@ void CPUCompareVCOUNT()
 
 }
 
+// Returns where a DMA unit at address lives in one of the plain memory
+// arrays, and in run how many bytes follow it there before the next mirror
+// or region boundary. NULL when the unit has to go through the CPU memory
+// handlers: BIOS, I/O, GPIO, save memory, the unusable part of VRAM in
+// bitmap modes, or ROM under the GC virtual memory.
+static u8 *dmaMemoryBlock(u32 address, bool write, u32 &run)
+{
+  switch(address >> 24) {
+  case 2:
+    run = 0x40000 - (address & 0x3FFFF);
+    return &workRAM[address & 0x3FFFF];
+  case 3:
+    run = 0x8000 - (address & 0x7FFF);
+    return &internalRAM[address & 0x7FFF];
+  case 5:
+    if(write && address >= 0x5000400 && (RomIdCode & 0xFFFFFF) == CORVETTE)
+      return NULL;
+    run = 0x400 - (address & 0x3FF);
+    return &paletteRAM[address & 0x3FF];
+  case 6:
+    {
+      u32 a = address & 0x1FFFF;
+      if(((DISPCNT & 7) > 2) && ((a & 0x1C000) == 0x18000))
+        return NULL;
+      if((a & 0x18000) == 0x18000)
+        a &= 0x17FFF;
+      run = 0x4000 - (a & 0x3FFF);
+      return &vram[a];
+    }
+  case 7:
+    run = 0x400 - (address & 0x3FF);
+    return &oam[address & 0x3FF];
+#ifndef USE_VM
+  case 8:
+    if(address < 0x80000CA) // GPIO
+      return NULL;
+    // fall through
+  case 9:
+  case 10:
+  case 11:
+  case 12:
+    if(write)
+      return NULL;
+    run = 0x2000000 - (address & 0x1FFFFFF);
+    // 0x0D is EEPROM, not the rest of the ROM mirror
+    if((address >> 24) == 12)
+      run = 0x1000000 - (address & 0xFFFFFF);
+    return &rom[address & 0x1FFFFFF];
+#endif
+  }
+  return NULL;
+}
+
+// Transfers as many units of size bytes as possible straight between the
+// memory arrays, for incrementing DMAs and those with a fixed source, and
+// returns how many. 0 means the next unit has to go through
+// CPUReadMemory/CPUWriteMemory.
+static u32 dmaBlockTransfer(u32 &s, u32 &d, u32 si, u32 di, u32 c, u32 size)
+{
+#ifdef BKPT_SUPPORT
+  // frozen cheat addresses are checked unit by unit
+  return 0;
+#else
+  u32 srun, drun;
+
+  if(di != size || (si != size && si != 0))
+    return 0;
+
+  u8 *src = dmaMemoryBlock(s, false, srun);
+  u8 *dst = dmaMemoryBlock(d & ~(size - 1), true, drun);
+
+  if(!src || !dst)
+    return 0;
+
+  u32 n = c;
+  if(si && n > srun / size)
+    n = srun / size;
+  if(n > drun / size)
+    n = drun / size;
+
+  u32 bytes = n * size;
+
+  if(si == 0) {
+    u8 unit[4];
+    memcpy(unit, src, size);
+    for(u32 i = 0; i < bytes; i += size)
+      memcpy(dst + i, unit, size);
+  } else if(dst >= src + bytes || src >= dst + bytes) {
+    memcpy(dst, src, bytes);
+  } else {
+    // overlapping: a forward byte copy reads each unit after the units
+    // before it were written, like the unit by unit transfer
+    for(u32 i = 0; i < bytes; i++)
+      dst[i] = src[i];
+  }
+
+  // the last unit written is the last unit read
+  if(size == 4) {
+    cpuDmaLast = READ32LE(((u32 *)(dst + bytes - 4)));
+  } else {
+    cpuDmaLast = READ16LE(((u16 *)(dst + bytes - 2)));
+    cpuDmaLast |= (cpuDmaLast<<16);
+  }
+
+  s += si * n;
+  d += di * n;
+  return n;
+#endif
+}
+
 void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 {
   int sm = s >> 24;
@@ -2236,6 +2346,11 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
       }
     } else {
       while(c != 0) {
+        u32 n = dmaBlockTransfer(s, d, si, di, c, 4);
+        if(n) {
+          c -= n;
+          continue;
+        }
         cpuDmaLast = CPUReadMemory(s);
         CPUWriteMemory(d, cpuDmaLast);
         d += di;
@@ -2255,6 +2370,11 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
       }
     } else {
       while(c != 0) {
+        u32 n = dmaBlockTransfer(s, d, si, di, c, 2);
+        if(n) {
+          c -= n;
+          continue;
+        }
         cpuDmaLast = CPUReadHalfWord(s);
         CPUWriteHalfWord(d, cpuDmaLast);
         cpuDmaLast |= (cpuDmaLast<<16);
@@ -3786,6 +3906,25 @@ void CPULoop(int ticks)
               switch(systemColorDepth) {
                 case 16:
                 {
+                  if(systemTiledScreen) {
+                    u16 *dest = SYSTEM_TILED_PIXEL(0, VCOUNT);
+                    u16 diff = 0;
+                    if(systemColorMapDirect) {
+                      for(u32 x = 0; x < 240u; x += 4, dest += 16)
+                        diff |= systemTiledStoreDirect(dest, lineMix[x],
+                          lineMix[x+1], lineMix[x+2], lineMix[x+3]);
+                    } else {
+                      for(u32 x = 0; x < 240u; dest += 12) {
+                        SYSTEM_TILED_STORE(dest, systemColorMap16[lineMix[x++]&0xFFFF], diff);
+                        SYSTEM_TILED_STORE(dest, systemColorMap16[lineMix[x++]&0xFFFF], diff);
+                        SYSTEM_TILED_STORE(dest, systemColorMap16[lineMix[x++]&0xFFFF], diff);
+                        SYSTEM_TILED_STORE(dest, systemColorMap16[lineMix[x++]&0xFFFF], diff);
+                      }
+                    }
+                    if(diff)
+                      systemScreenChanged = true;
+                    break;
+                  }
                   u16 *dest = (u16 *)pix + 242 * (VCOUNT+1);
                   for(u32 x = 0; x < 240u;) {
                     *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
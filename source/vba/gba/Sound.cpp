@@ -48,6 +48,8 @@ float soundFiltering     = 0.5f;
 int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
 int   soundTicks         = SOUND_CLOCK_TICKS_;
 
+bool  soundSplitChannels = false;
+
 static float soundVolume     = 1.0f;
 static int soundEnableFlag   = 0x3ff; // emulator channels enabled
 static float soundFiltering_ = -1.0f;
@@ -59,7 +61,7 @@ class Gba_Pcm {
 public:
 	void init();
 	void apply_control( int idx );
-	void update( int dac );
+	void update( blip_time_t, int dac );
 	void end_frame( blip_time_t );
 
 private:
@@ -77,6 +79,7 @@ public:
 	void write_control( int data );
 	void write_fifo( int data );
 	void timer_overflowed( int which_timer );
+	void flush();
 
 	// public only so save state routines can access it
 	int  readIndex;
@@ -85,14 +88,24 @@ public:
 	int  dac;
 	u8   fifo [32];
 private:
+	// Overflows that don't need a refill only record their time. flush()
+	// then reads their samples from the FIFO in one pass, at the overflow
+	// that refills it and before anything else looks at the FIFO.
+	enum { max_pending = 16 };
 
 	int  timer;
 	bool enabled;
+	int  pending;
+	blip_time_t pending_time [max_pending];
 };
 
 static Gba_Pcm_Fifo     pcm [2];
 static Gb_Apu*          gb_apu;
-static Stereo_Buffer*   stereo_buffer;
+static Multi_Buffer*    stereo_buffer;
+static bool             split_channels_;
+
+// Channels as numbered by soundSetEnable()
+static int const        chan_count = 6;
 
 static Blip_Synth<blip_best_quality,1> pcm_synth [3]; // 32 kHz, 16 kHz, 8 kHz
 
@@ -117,12 +130,13 @@ void Gba_Pcm::apply_control( int idx )
 	if ( (soundEnableFlag >> idx & 0x100) && (ioMem [NR52] & 0x80) )
 		ch = ioMem [SGCNT0_H+1] >> (idx <<2) & 3;
 
+	Multi_Buffer::channel_t const chan = stereo_buffer->channel( 4 + idx );
 	Blip_Buffer* out = 0;
 	switch ( ch )
 	{
-	case 1: out = stereo_buffer->right();  break;
-	case 2: out = stereo_buffer->left();   break;
-	case 3: out = stereo_buffer->center(); break;
+	case 1: out = chan.right;  break;
+	case 2: out = chan.left;   break;
+	case 3: out = chan.center; break;
 	}
 
 	if ( output != out )
@@ -147,12 +161,10 @@ void Gba_Pcm::end_frame( blip_time_t time )
 		output->set_modified();
 }
 
-void Gba_Pcm::update( int dac )
+void Gba_Pcm::update( blip_time_t time, int dac )
 {
 	if ( output )
 	{
-		blip_time_t time = blip_time();
-
 		dac = (s8) dac >> shift;
 		int delta = dac - last_amp;
 		if ( delta )
@@ -182,36 +194,53 @@ void Gba_Pcm_Fifo::timer_overflowed( int which_timer )
 {
 	if ( which_timer == timer && enabled )
 	{
-		/* Mother 3 fix, refined to not break Metroid Fusion */
-		if ( count == 16 || count == 0 )
+		int const left = count - pending;
+		if ( left == 16 || left == 0 || pending == max_pending )
 		{
-			// Need to fill FIFO
-			int saved_count = count;
-			CPUCheckDMA( 3, which ? 4 : 2 );
-			if ( saved_count == 0 && count == 16 )
-				CPUCheckDMA( 3, which ? 4 : 2 );
-			if ( count == 0 )
+			flush();
+
+			/* Mother 3 fix, refined to not break Metroid Fusion */
+			if ( count == 16 || count == 0 )
 			{
-				// Not filled by DMA, so fill with 16 bytes of silence
-				int reg = which ? FIFOB_L : FIFOA_L;
-				for ( int n = 8; n--; )
+				// Need to fill FIFO
+				int saved_count = count;
+				CPUCheckDMA( 3, which ? 4 : 2 );
+				if ( saved_count == 0 && count == 16 )
+					CPUCheckDMA( 3, which ? 4 : 2 );
+				if ( count == 0 )
 				{
-					soundEvent(reg  , (u16)0);
-					soundEvent(reg+2, (u16)0);
+					// Not filled by DMA, so fill with 16 bytes of silence
+					int reg = which ? FIFOB_L : FIFOA_L;
+					for ( int n = 8; n--; )
+					{
+						soundEvent(reg  , (u16)0);
+						soundEvent(reg+2, (u16)0);
+					}
 				}
 			}
 		}
 
-		// Read next sample from FIFO
+		// Next sample is read from FIFO by flush()
+		pending_time [pending++] = blip_time();
+	}
+}
+
+void Gba_Pcm_Fifo::flush()
+{
+	for ( int i = 0; i < pending; i++ )
+	{
 		--count;
 		dac = fifo [readIndex];
 		readIndex = (readIndex + 1) & 31;
-		pcm.update( dac );
+		pcm.update( pending_time [i], dac );
 	}
+	pending = 0;
 }
 
 void Gba_Pcm_Fifo::write_control( int data )
 {
+	flush();
+
 	enabled = (data & 0x0300) ? true : false;
 	timer   = (data & 0x0400) ? 1 : 0;
 
@@ -226,11 +255,13 @@ void Gba_Pcm_Fifo::write_control( int data )
 	}
 
 	pcm.apply_control( which );
-	pcm.update( dac );
+	pcm.update( blip_time(), dac );
 }
 
 void Gba_Pcm_Fifo::write_fifo( int data )
 {
+	flush();
+
 	fifo [writeIndex  ] = data & 0xFF;
 	fifo [writeIndex+1] = data >> 8;
 	count += 2;
@@ -239,6 +270,9 @@ void Gba_Pcm_Fifo::write_fifo( int data )
 
 static void apply_control()
 {
+	pcm [0].flush();
+	pcm [1].flush();
+
 	pcm [0].pcm.apply_control( 0 );
 	pcm [1].pcm.apply_control( 1 );
 }
@@ -345,6 +379,9 @@ void soundTimerOverflow(int timer)
 
 static void end_frame( blip_time_t time )
 {
+	pcm [0].flush();
+	pcm [1].flush();
+
 	pcm [0].pcm.end_frame( time );
 	pcm [1].pcm.end_frame( time );
 
@@ -375,6 +412,13 @@ void flush_samples(Multi_Buffer * buffer)
 
 		soundDriver->write(soundFinalWave, soundBufferLen);
 		systemOnWriteDataToSoundBuffer(soundFinalWave, soundBufferLen);
+
+		for ( int i = 0; i < buffer->channel_count(); i++ )
+		{
+			blip_sample_t const* chan = buffer->channel_samples( i );
+			if ( chan )
+				systemOnWriteChannelToSoundBuffer( i, (u16 const*) chan, soundBufferLen );
+		}
 	}
 }
 
@@ -396,6 +440,8 @@ static void apply_filtering()
 	}
 }
 
+static void remake_stereo_buffer();
+
 void psoundTickfn()
 {
  	if ( gb_apu && stereo_buffer )
@@ -410,6 +456,9 @@ void psoundTickfn()
 
 		if ( soundVolume_ != soundVolume )
 			apply_volume();
+
+		if ( split_channels_ != soundSplitChannels )
+			remake_stereo_buffer();
 	}
 }
 
@@ -427,8 +476,10 @@ static void apply_muting()
 		for ( int i = 0; i < 4; i++ )
 		{
 			if ( soundEnableFlag >> i & 1 )
-				gb_apu->set_output( stereo_buffer->center(),
-						stereo_buffer->left(), stereo_buffer->right(), i );
+			{
+				Multi_Buffer::channel_t const ch = stereo_buffer->channel( i );
+				gb_apu->set_output( ch.center, ch.left, ch.right, i );
+			}
 			else
 				gb_apu->set_output( 0, 0, 0, i );
 		}
@@ -451,6 +502,8 @@ static void remake_stereo_buffer()
 		return;
 
 	// Clears pointers kept to old stereo_buffer
+	pcm [0].flush();
+	pcm [1].flush();
 	pcm [0].pcm.init();
 	pcm [1].pcm.init();
 
@@ -458,9 +511,14 @@ static void remake_stereo_buffer()
 	delete stereo_buffer;
 	stereo_buffer = 0;
 
-	stereo_buffer = new Stereo_Buffer; // TODO: handle out of memory
+	split_channels_ = soundSplitChannels;
+	if ( split_channels_ )
+		stereo_buffer = new Split_Buffer; // TODO: handle out of memory
+	else
+		stereo_buffer = new Stereo_Buffer; // TODO: handle out of memory
 	stereo_buffer->set_sample_rate( soundSampleRate ); // TODO: handle out of memory
 	stereo_buffer->clock_rate( gb_apu->clock_rate );
+	stereo_buffer->set_channel_count( chan_count ); // TODO: handle out of memory
 
 	// PCM
 	pcm [0].which = 0;
@@ -753,6 +811,9 @@ static void skip_read( gzFile in, int count )
 
 void soundSaveGame( gzFile out )
 {
+	pcm [0].flush();
+	pcm [1].flush();
+
 	gb_apu->save_state( &state.apu );
 
 	// Be sure areas for expansion get written as zero
@@ -801,6 +862,8 @@ static void soundReadGameOld( gzFile in, int version )
 void soundReadGame( gzFile in, int version )
 {
 	// Prepare APU and default state
+	pcm [0].flush();
+	pcm [1].flush();
 	reset_apu();
 	gb_apu->save_state( &state.apu );
 
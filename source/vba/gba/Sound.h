@@ -45,6 +45,11 @@ void soundSetSampleRate(long sampleRate);
 extern bool soundInterpolation; // 1 if PCM should have low-pass filtering
 extern float soundFiltering;    // 0.0 = none, 1.0 = max
 
+// If true, each channel is mixed on its own and passed to
+// systemOnWriteChannelToSoundBuffer(), numbered as in soundSetEnable() with
+// PCM 1 and 2 as channels 4 and 5. Takes effect at the next sound tick.
+extern bool soundSplitChannels;
+
 
 //// GBA sound emulation
 
@@ -26,6 +26,8 @@
 #include "vbasupport.h"
 #include "preferences.h"
 #include "audio.h"
+#include "audiocapture.h"
+#include "batterysave.h"
 #include "networkop.h"
 #include "filebrowser.h"
 #include "fileop.h"
@@ -84,6 +86,7 @@ void ExitApp()
 	ShutoffRumble();
 #endif
 
+	StopBatterySaver();
 	SavePrefs(SILENT);
 
 	if (ROMLoaded && !ConfigRequested && GCSettings.AutoSave == 1)
@@ -419,6 +422,8 @@ int main(int argc, char *argv[])
 			// since we're entering the menu
 			ResumeDeviceThread();
 
+			StopAudioCapture();
+			StopBatterySaver();
 			SwitchAudioMode(1);
 
 			if(!ROMLoaded)
@@ -433,6 +438,17 @@ int main(int argc, char *argv[])
 
 		SwitchAudioMode(0);
 
+		if(GCSettings.AudioCapture && ChangeInterface(GCSettings.SaveMethod, SILENT))
+		{
+			char filepath[1024];
+			snprintf(filepath, 1024, "%s%s/%s", pathPrefix[GCSettings.SaveMethod], GCSettings.ScreenshotsFolder, ROMFilename);
+			StartAudioCapture(filepath, GCSettings.AudioCapture, soundGetSampleRate());
+		}
+
+		// save the battery in the background while playing
+		if(GCSettings.AutoSave == 1 || GCSettings.AutoSave == 3)
+			StartBatterySaver();
+
 		// stop checking if devices were removed/inserted
 		// since we're starting emulation again
 		HaltDeviceThread();
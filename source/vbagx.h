@@ -83,6 +83,8 @@ struct SGCSettings
 	int		videomode;     // 0 - automatic, 1 - NTSC (480i), 2 - Progressive (480p), 3 - PAL (50Hz), 4 - PAL (60Hz)
 	int		scaling;       // 0 - default, 1 - partial stretch, 2 - stretch to fit, 3 - widescreen correction
 	int		render;		   // 0 - original, 1 - filtered, 2 - unfiltered
+	int		postfilter;    // 0 - none, 1 - LCD grid, 2 - scanlines
+	int		frameblend;    // mix each frame with the previous one (LCD ghosting)
 	int		xshift;		   // video output shift
 	int		yshift;
 	int		colorize;      // colorize Mono Gameboy games
@@ -96,6 +98,7 @@ struct SGCSettings
 	int 	language;
 	int		PreviewImage;
 	int		AutoloadGame;
+	int		AudioCapture;  // 0 - off, 1 - mixed output, 2 - mixed output and each channel (not saved)
 	
 	int		OffsetMinutesUTC; // Used for clock on MBC3 and TAMA5
 	int 	GBHardware;    // Mapped to gbEmulatorType in VBA
@@ -23,12 +23,15 @@
 #include "fileop.h"
 #include "filebrowser.h"
 #include "audio.h"
+#include "audiocapture.h"
+#include "batterysave.h"
 #include "vmmem.h"
 #include "input.h"
 #include "gameinput.h"
 #include "video.h"
 #include "menu.h"
 #include "gcunzip.h"
+#include "romsniff.h"
 #include "gamesettings.h"
 #include "preferences.h"
 #include "fastmath.h"
@@ -75,6 +78,10 @@ int systemRedShift = 0;
 int systemBlueShift = 0;
 int systemGreenShift = 0;
 int systemColorDepth = 0;
+u16 *systemTiledScreen = NULL;
+int systemTiledScreenWidth = 0;
+bool systemScreenChanged = true;
+bool systemColorMapDirect = false;
 u16 systemGbPalette[24];
 u16 systemColorMap16[0x10000];
 u32 *systemColorMap32 = NULL;
@@ -131,6 +138,8 @@ static u32 lastTime = 0;
 
 void system10Frames(int rate)
 {
+	UpdateBatterySaver();
+
 	u32 time = gettime();
 	u32 diff = diff_usec(lastTime, time);
 
@@ -215,6 +224,9 @@ bool MemCPUReadBatteryFile(char * membuffer, int size)
 
 extern int gbaSaveType;
 
+// the save file was in Goomba format, which only SaveBatteryOrState handles
+static bool goombaBattery = false;
+
 int MemCPUWriteBatteryFile(char * membuffer)
 {
 	int result = 0;
@@ -275,12 +287,22 @@ bool LoadBatteryOrState(char * filepath, int action, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
+	// finish a background save that was cut off before its rename
+	if(action == FILE_SRAM && ChangeInterface(device, SILENT))
+	{
+		AcquireDevice(device);
+		RecoverBatterySave(filepath);
+		ReleaseDevice(device);
+	}
+
 	AllocSaveBuffer();
 
 	// load the file into savebuffer
 	offset = LoadFile(filepath, silent);
 			
 	if (cartridgeType == 1 && goomba_is_sram(savebuffer)) {
+		if (action == FILE_SRAM)
+			goombaBattery = true;
 		void* cleaned = goomba_cleanup(savebuffer);
 		if (savebuffer == NULL) {
 			ErrorPrompt(goomba_last_error());
@@ -397,6 +419,8 @@ bool SaveBatteryOrState(char * filepath, int action, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
+	WaitScreenshot();
+
 	if(action == FILE_SNAPSHOT && gameScreenPngSize > 0)
 	{
 		char screenpath[1024];
@@ -480,6 +504,26 @@ bool SaveBatteryOrState(char * filepath, int action, bool silent)
 	return result;
 }
 
+/****************************************************************************
+* SnapshotBatteryFile
+* Copies the battery save into membuffer for the background saver
+* Returns the size, or 0 if the save can't be written as a plain file
+****************************************************************************/
+
+int SnapshotBatteryFile(char * membuffer, int size)
+{
+	if(goombaBattery)
+		return 0;
+
+	if(cartridgeType == 1)
+	{
+		if(gbBattery == 0 || gbRamSize + 0x100 > size) // ram plus clock data
+			return 0;
+		return MemgbWriteBatteryFile(membuffer);
+	}
+	return MemCPUWriteBatteryFile(membuffer);
+}
+
 bool SaveBatteryOrStateAuto(int action, bool silent)
 {
 	char filepath[1024];
@@ -500,6 +544,8 @@ int SavePreviewImg(char * filepath, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
+	WaitScreenshot();
+
 	if(gameScreenPngSize > 0)
 	{
 		char screenpath[1024];
@@ -531,6 +577,12 @@ bool systemCanChangeSoundQuality()
 
 void systemOnWriteDataToSoundBuffer(const u16 * finalWave, int length)
 {
+	AudioCaptureWrite(0, finalWave, length);
+}
+
+void systemOnWriteChannelToSoundBuffer(int channel, const u16 * finalWave, int length)
+{
+	AudioCaptureWrite(channel + 1, finalWave, length);
 }
 
 void systemOnSoundShutdown()
@@ -891,19 +943,20 @@ static void ApplyPerImagePreferences()
 	}
 }
 
-void LoadPatch()
+void LoadPatch(const u32 * romCRC)
 {
 	int patchsize = 0;
 	int patchtype = 0;
 
 	AllocSaveBuffer ();
 
-	char patchpath[2][512];
+	char patchpath[3][512];
 	memset(patchpath, 0, sizeof(patchpath));
 	sprintf(patchpath[0], "%s%s.ips",browser.dir,ROMFilename);
 	sprintf(patchpath[1], "%s%s.ups",browser.dir,ROMFilename);
+	sprintf(patchpath[2], "%s%s.bps",browser.dir,ROMFilename);
 
-	for(; patchtype<2; patchtype++)
+	for(; patchtype<3; patchtype++)
 	{
 		patchsize = LoadFile(patchpath[patchtype], SILENT);
 
@@ -921,15 +974,19 @@ void LoadPatch()
 		{
 			if(patchtype == 0)
 				patchApplyIPS(mf, &gbRom, &gbRomSize);
+			else if(patchtype == 1)
+				patchApplyUPS(mf, &gbRom, &gbRomSize, romCRC);
 			else
-				patchApplyUPS(mf, &gbRom, &gbRomSize);
+				patchApplyBPS(mf, &gbRom, &gbRomSize, romCRC);
 		}
 		else
 		{
 			if(patchtype == 0)
-				patchApplyIPS(mf, &rom, &GBAROMSize);
+				patchApplyIPS(mf, &rom, &GBAROMSize, (1024*1024*32));
+			else if(patchtype == 1)
+				patchApplyUPS(mf, &rom, &GBAROMSize, romCRC, (1024*1024*32));
 			else
-				patchApplyUPS(mf, &rom, &GBAROMSize);
+				patchApplyBPS(mf, &rom, &GBAROMSize, romCRC, (1024*1024*32));
 		}
 
 		memfclose(mf); // close memory file
@@ -1067,6 +1124,13 @@ bool LoadGBROM()
 	gbEmulatorType = GCSettings.GBHardware;
 
 	gbRom = (u8 *)malloc(1024*1024*8);
+	if (!gbRom)
+	{
+		// the 7z decoder kept for the rest of a solid block can hold a
+		// 16MB dictionary, which the ROM needs more
+		SzClearCache();
+		gbRom = (u8 *)malloc(1024*1024*8);
+	}
 	if (!gbRom) 
 	{
 		InfoPrompt("Unable to allocate 8 MB of memory");
@@ -1134,7 +1198,12 @@ bool utilIsZipFile(const char* file)
 bool LoadVBAROM()
 {
 	cartridgeType = 0;
+	goombaBattery = false;
 	int loaded = 0;
+	char filepath[1024];
+
+	if(inSz || !MakeFilePath(filepath, FILE_ROM))
+		filepath[0] = 0;
 
 	// image type (checks file extension)
 	if(utilIsGBAImage(browserList[browser.selIndex].filename))
@@ -1143,29 +1212,28 @@ bool LoadVBAROM()
 		cartridgeType = 1;
 	else if(utilIsZipFile(browserList[browser.selIndex].filename))
 	{
-		// we need to check the file extension of the first file in the archive
-		char * zippedFilename = GetFirstZipFilename ();
+		// identify the zipped ROM from its header, without unzipping it
+		ROMSNIFF sniff;
 
-		if(zippedFilename == NULL) // loading the file failed
+		if(!SniffRom(filepath, &sniff)) // loading the file failed
 		{
 			ErrorPrompt("Empty or invalid ZIP file!");
 			return false;
 		}
 
-		if(utilIsGBAImage(zippedFilename))
-		{
+		// the member's extension also sets up multiboot images
+		bool gbaName = utilIsGBAImage(sniff.member);
+
+		if(sniff.type == ROMTYPE_GBA)
 			cartridgeType = 2;
-		}
-		else if(utilIsGBImage(zippedFilename))
-		{
+		else if(sniff.type == ROMTYPE_GB)
+			cartridgeType = 1;
+		else if(gbaName) // no recognizable header - go by the extension
+			cartridgeType = 2;
+		else if(utilIsGBImage(sniff.member))
 			cartridgeType = 1;
-		}
 		else
-		{
-			free(zippedFilename);
 			return false;
-		}
-		free(zippedFilename);
 	}
 
 	// leave before we do anything
@@ -1238,12 +1306,18 @@ bool LoadVBAROM()
 	}
 	else
 	{
-		// Setup GX
-		if (InitialBorder) {
-			GX_Render_Init(InitialBorderWidth, InitialBorderHeight);
-		} else {
-			GX_Render_Init(srcWidth, srcHeight);
-		}
+		// CRC of the unpatched ROM, if it was worked out while loading
+		u32 romCRC;
+		bool romCRCKnown;
+
+		if (cartridgeType == 1)
+			romCRCKnown = GetLoadedFileCRC(gbRom, gbRomSize, &romCRC);
+		else
+			romCRCKnown = GetLoadedFileCRC(rom, GBAROMSize, &romCRC);
+
+		// Setup GX. The core draws straight into the texture, except with an
+		// SGB border, which is composed in pix around the game.
+		GX_Render_Init(srcWidth, srcHeight, !(cartridgeType == 1 && gbBorderOn));
 
 		if (cartridgeType == 1)
 		{
@@ -1253,7 +1327,7 @@ bool LoadVBAROM()
 			//if (gbHardware & 5)
 			//gbCPUInit(gbBiosFileName, useBios);
 
-			LoadPatch();
+			LoadPatch(romCRCKnown ? &romCRC : NULL);
 
 			// Apply preferences specific to this game
 			gbApplyPerImagePreferences();
@@ -1277,7 +1351,7 @@ bool LoadVBAROM()
 
 			soundReset();
 			CPUInit(NULL, false);
-			LoadPatch();
+			LoadPatch(romCRCKnown ? &romCRC : NULL);
 			CPUReset();
 		}
 
@@ -1333,4 +1407,5 @@ void InitialisePalette()
 			(((i & 0x3e0) >> 5) << systemGreenShift) |
 			(((i & 0x7c00) >> 10) << systemBlueShift);
 	}
+	systemColorMapDirect = true;
 }
@@ -29,6 +29,7 @@ bool LoadBatteryOrState(char * filepath, int action, bool silent);
 bool LoadBatteryOrStateAuto(int action, bool silent);
 bool SaveBatteryOrState(char * filepath, int action, bool silent);
 bool SaveBatteryOrStateAuto(int action, bool silent);
+int SnapshotBatteryFile(char * membuffer, int size);
 bool SavePreviewImg (char * filepath, bool silent);
 
 #endif
@@ -21,6 +21,7 @@
 #include "menu.h"
 #include "input.h"
 #include "vbasupport.h"
+#include "vba/System.h"
 
 s32 CursorX, CursorY;
 bool CursorVisible;
@@ -37,9 +38,16 @@ int whichfb = 0; // Frame buffer toggle
 
 static Mtx GXmodelView2D;
 
+u8 * gameScreenTex = NULL; // last screenshot, as an RGBA8 texture
 u8 * gameScreenPng = NULL;
 int gameScreenPngSize = 0;
 
+/*** Screenshot buffers ***/
+static u8 *screentexmem = NULL; // shown by the menu, kept for the next screenshot
+static int screentexsize = 0;
+static u8 *encodetexmem = NULL; // read by the encoder, freed once encoded
+static lwp_t screenshotthread = LWP_THREAD_NULL;
+
 int screenheight = 480;
 int screenwidth = 640;
 
@@ -56,11 +64,28 @@ static unsigned int copynow = GX_FALSE;
 /*** Texture memory ***/
 static u8 *texturemem = NULL;
 static int texturesize;
+static u8 *bordermem = NULL; // InitialBorder, uploaded once per game
+static u8 *blendmem = NULL; // previous frame, for frame blending
+static bool blendValid = false; // blendmem holds the last frame shown
+static bool blendPending = false; // the last frame shown was a blend of two
 
 static GXTexObj texobj;
+static GXTexObj bordertexobj;
+static GXTexObj blendtexobj;
 static Mtx view;
-static int vwidth, vheight;
+static int vwidth, vheight; // displayed image, including any border
+static int texwidth, texheight; // game texture
 static int updateScaling;
+
+/*** Post-processing mask ***/
+#define MASK_SIZE 8 // mask texels across one game pixel
+static u8 maskmem[MASK_SIZE * MASK_SIZE] ATTRIBUTE_ALIGN(32);
+static GXTexObj masktexobj;
+static int maskfilter = POSTFILTER_NONE; // effect maskmem holds
+
+// brightness across a game pixel, darkest at its far edge
+static const u8 maskprofile[MASK_SIZE] = { 255, 255, 255, 255, 255, 240, 200, 160 };
+static bool cursorDrawn = false; // the last frame shown has the cursor on it
 bool progressive = false;
 
 /* New texture based scaler */
@@ -165,10 +190,23 @@ static inline void draw_init(void)
 
 	GX_InvVtxCache ();	// update vertex cache
 
-	GX_InitTexObj(&texobj, texturemem, vwidth, vheight, GX_TF_RGB565,
+	GX_InitTexObj(&texobj, texturemem, texwidth, texheight, GX_TF_RGB565,
 		GX_CLAMP, GX_CLAMP, GX_FALSE);
 	if (GCSettings.render == 2)
 		GX_InitTexObjLOD(&texobj,GX_NEAR,GX_NEAR_MIP_NEAR,2.5,9.0,0.0,GX_FALSE,GX_FALSE,GX_ANISO_1); // original/unfiltered video mode: force texture filtering OFF
+
+	GX_InitTexObj(&blendtexobj, blendmem, texwidth, texheight, GX_TF_RGB565,
+		GX_CLAMP, GX_CLAMP, GX_FALSE);
+	if (GCSettings.render == 2)
+		GX_InitTexObjLOD(&blendtexobj,GX_NEAR,GX_NEAR_MIP_NEAR,2.5,9.0,0.0,GX_FALSE,GX_FALSE,GX_ANISO_1);
+
+	if (bordermem)
+	{
+		GX_InitTexObj(&bordertexobj, bordermem, vwidth, vheight, GX_TF_RGB565,
+			GX_CLAMP, GX_CLAMP, GX_FALSE);
+		if (GCSettings.render == 2)
+			GX_InitTexObjLOD(&bordertexobj,GX_NEAR,GX_NEAR_MIP_NEAR,2.5,9.0,0.0,GX_FALSE,GX_FALSE,GX_ANISO_1);
+	}
 }
 
 static inline void draw_vert(u8 pos, u8 c, f32 s, f32 t)
@@ -178,21 +216,25 @@ static inline void draw_vert(u8 pos, u8 c, f32 s, f32 t)
 	GX_TexCoord2f32(s, t);
 }
 
-static inline void draw_square(Mtx v)
+static inline void draw_square(Mtx v, f32 scaleX, f32 scaleY)
 {
+	Mtx r;			// screen rotation.
+	Mtx s;			// size within the border.
 	Mtx m;			// model matrix.
 	Mtx mv;			// modelview matrix.
 
 	if (TiltScreen)
 	{
-		guMtxRotDeg(m, 'z', -TiltAngle);
-		guMtxScaleApply(m, m, 0.8, 0.8, 1);
+		guMtxRotDeg(r, 'z', -TiltAngle);
+		guMtxScaleApply(r, r, 0.8, 0.8, 1);
 	}
 	else
 	{
-		guMtxIdentity(m);
+		guMtxIdentity(r);
 	}
 
+	guMtxScale(s, scaleX, scaleY, 1);
+	guMtxConcat(r, s, m);
 	guMtxTransApply(m, m, 0, 0, -100);
 	guMtxConcat(v, m, mv);
 
@@ -205,6 +247,86 @@ static inline void draw_square(Mtx v)
 	GX_End();
 }
 
+/****************************************************************************
+ * BuildMask
+ *
+ * Fills the I8 mask for a screen effect. I8 is stored in 8x4 tiles, so a
+ * mask 8 texels wide is already in tile order.
+ ***************************************************************************/
+static void BuildMask(int filter)
+{
+	for (int y = 0; y < MASK_SIZE; y++)
+	{
+		for (int x = 0; x < MASK_SIZE; x++)
+		{
+			int v = maskprofile[y];
+			if (filter == POSTFILTER_LCD_GRID)
+				v = v * maskprofile[x] / 255;
+			maskmem[y * MASK_SIZE + x] = v;
+		}
+	}
+	DCFlushRange(maskmem, sizeof(maskmem));
+
+	GX_InitTexObj(&masktexobj, maskmem, MASK_SIZE, MASK_SIZE, GX_TF_I8,
+		GX_REPEAT, GX_REPEAT, GX_FALSE);
+	maskfilter = filter;
+}
+
+/****************************************************************************
+ * SetupPostFilter
+ *
+ * Screen effects run on the GPU, as TEV stages after the one that samples
+ * the game texture: frame blending mixes in the previous frame, then the
+ * screen effect modulates by a mask repeated once per game pixel.
+ * ResetPostFilter goes back to a single stage.
+ ***************************************************************************/
+static void SetupPostFilter()
+{
+	u8 stage = GX_TEVSTAGE1;
+
+	if (GCSettings.frameblend)
+	{
+		// colour = (previous + last frame) / 2, alpha passed through
+		GX_LoadTexObj(&blendtexobj, GX_TEXMAP2);
+		GX_SetTevOrder(stage, GX_TEXCOORD0, GX_TEXMAP2, GX_COLORNULL);
+		GX_SetTevColorIn(stage, GX_CC_CPREV, GX_CC_TEXC, GX_CC_HALF, GX_CC_ZERO);
+		GX_SetTevColorOp(stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+		GX_SetTevAlphaIn(stage, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_APREV);
+		GX_SetTevAlphaOp(stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+		stage++;
+	}
+
+	if (GCSettings.postfilter != POSTFILTER_NONE)
+	{
+		if (GCSettings.postfilter != maskfilter)
+			BuildMask(GCSettings.postfilter);
+
+		Mtx m;
+		guMtxScale(m, texwidth, texheight, 1);
+		GX_LoadTexMtxImm(m, GX_TEXMTX0, GX_MTX2x4);
+
+		GX_SetNumTexGens(2);
+		GX_SetTexCoordGen(GX_TEXCOORD1, GX_TG_MTX2x4, GX_TG_TEX0, GX_TEXMTX0);
+		GX_LoadTexObj(&masktexobj, GX_TEXMAP1);
+
+		// colour = previous * mask, alpha passed through
+		GX_SetTevOrder(stage, GX_TEXCOORD1, GX_TEXMAP1, GX_COLORNULL);
+		GX_SetTevColorIn(stage, GX_CC_ZERO, GX_CC_CPREV, GX_CC_TEXC, GX_CC_ZERO);
+		GX_SetTevColorOp(stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+		GX_SetTevAlphaIn(stage, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_APREV);
+		GX_SetTevAlphaOp(stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+		stage++;
+	}
+
+	GX_SetNumTevStages(stage);
+}
+
+static void ResetPostFilter()
+{
+	GX_SetNumTevStages(1);
+	GX_SetNumTexGens(1);
+}
+
 #ifdef HW_RVL
 static inline void draw_cursor(Mtx v)
 {
@@ -251,7 +373,7 @@ static inline void draw_cursor(Mtx v)
 
 	GX_InvVtxCache ();	// update vertex cache
 
-	GX_InitTexObj(&texobj, texturemem, vwidth, vheight, GX_TF_RGB565,
+	GX_InitTexObj(&texobj, texturemem, texwidth, texheight, GX_TF_RGB565,
 		GX_CLAMP, GX_CLAMP, GX_FALSE);
 	if (GCSettings.render == 2)
 		GX_InitTexObjLOD(&texobj,GX_NEAR,GX_NEAR_MIP_NEAR,2.5,9.0,0.0,GX_FALSE,GX_FALSE,GX_ANISO_1); // original/unfiltered video mode: force texture filtering OFF
@@ -567,7 +689,7 @@ ResetVideo_Emu ()
 
 	// reinitialize texture
 	GX_InvalidateTexAll ();
-	GX_InitTexObj (&texobj, texturemem, vwidth, vheight, GX_TF_RGB565, GX_CLAMP, GX_CLAMP, GX_FALSE);	// initialize the texture obj we are going to use
+	GX_InitTexObj (&texobj, texturemem, texwidth, texheight, GX_TF_RGB565, GX_CLAMP, GX_CLAMP, GX_FALSE);	// initialize the texture obj we are going to use
 	if (GCSettings.render == 2)
 		GX_InitTexObjLOD(&texobj,GX_NEAR,GX_NEAR_MIP_NEAR,2.5,9.0,0.0,GX_FALSE,GX_FALSE,GX_ANISO_1); // original/unfiltered video mode: force texture filtering OFF
 
@@ -578,11 +700,26 @@ ResetVideo_Emu ()
 	updateScaling = 1;
 }
 
-void GX_Render_Init(int width, int height)
+/****************************************************************************
+ * GX_Render_Init
+ *
+ * Sets up the game texture. With tiled, the core writes its lines straight
+ * into the texture, otherwise GX_Render tiles the frame from pix.
+ ***************************************************************************/
+void GX_Render_Init(int width, int height, bool tiled)
 {
 	if (texturemem)
 		free(texturemem);
 
+	if (blendmem)
+		free(blendmem);
+
+	if (bordermem)
+	{
+		free(bordermem);
+		bordermem = NULL;
+	}
+
 	/*** Allocate 32byte aligned texture memory ***/
 	texturesize = (width * height) * 2;
 
@@ -590,9 +727,33 @@ void GX_Render_Init(int width, int height)
 
 	memset(texturemem, 0, texturesize);
 
+	// allocated up front so blending can be turned on at any time
+	blendmem = (u8 *) memalign(32, texturesize);
+	blendValid = false;
+
+	systemTiledScreen = tiled ? (u16 *) texturemem : NULL;
+	systemTiledScreenWidth = width;
+
 	/*** Setup for first call to scaler ***/
-	vwidth = width;
-	vheight = height;
+	texwidth = vwidth = width;
+	texheight = vheight = height;
+
+	// The InitialBorder, if any, is already tiled and never changes
+	if (InitialBorder)
+	{
+		int bordersize = InitialBorderWidth * InitialBorderHeight * 2;
+		bordermem = (u8 *) memalign(32, bordersize);
+
+		if (bordermem)
+		{
+			memcpy(bordermem, InitialBorder, bordersize);
+			DCFlushRange(bordermem, bordersize);
+			vwidth = InitialBorderWidth;
+			vheight = InitialBorderHeight;
+		}
+	}
+
+	updateScaling = 1;
 }
 
 bool borderAreaEmpty(const u16* buffer) {
@@ -619,16 +780,13 @@ bool borderAreaEmpty(const u16* buffer) {
 }
 
 /****************************************************************************
-* GX_Render
-*
-* Pass in a buffer, width and height to update as a tiled RGB565 texture
-* (2 bytes per pixel)
-****************************************************************************/
-void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
+ * CopyToTexture
+ *
+ * Tiles a linear frame from pix (2 bytes per pixel, plus 2 pixels of padding
+ * per line) into the texture
+ ***************************************************************************/
+static void CopyToTexture(int gbWidth, int gbHeight, u8 * buffer)
 {
-	int borderWidth = InitialBorder ? InitialBorderWidth : gbWidth;
-	int borderHeight = InitialBorder ? InitialBorderHeight : gbHeight;
-
 	int h, w;
 	int gbPitch = gbWidth * 2 + 4;
 	long long int *dst = (long long int *) texturemem; // Pointer in 8-byte units / 4-pixel units
@@ -638,48 +796,10 @@ void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
 	long long int *src4 = (long long int *) (buffer + (gbPitch * 3));
 	int srcrowpitch = (gbPitch >> 3) * 3;
 	int srcrowadjust = ( gbPitch % 8 ) << 2;
-	int dstrowpitch = borderWidth - gbWidth;
-
-	vwidth = borderWidth;
-	vheight = borderHeight;
 
 	int vwid2 = (gbWidth >> 2);
 	char *ra = NULL;
-	
-	// Ensure previous vb has complete
-	while ((LWP_ThreadIsSuspended (vbthread) == 0) || (copynow == GX_TRUE))
-		usleep (50);
-
-	whichfb ^= 1;
 
-	if(updateScaling)
-		UpdateScaling();
-
-	// clear texture objects
-	GX_InvVtxCache();
-	GX_InvalidateTexAll();
-	GX_SetTevOp(GX_TEVSTAGE0, GX_DECAL);
-	GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
-	
-	if (gbWidth == 256 && gbHeight == 224 && !SGBBorderLoadedFromGame) {
-		if (borderAreaEmpty((u16*)buffer)) {
-			// TODO: don't paint empty SGB border
-		} else {
-			// don't try to load the default border anymore
-			SGBBorderLoadedFromGame = true;
-			SaveSGBBorderIfNoneExists(buffer);
-		}
-	}
-	
-	// The InitialBorder, if any, should already be properly tiled
-	if (InitialBorder) {
-		memcpy(dst, InitialBorder, borderWidth * borderHeight * 2);
-		
-		int rows_to_skip = (borderHeight - gbHeight) / 2;
-		if (rows_to_skip > 0) dst += rows_to_skip * borderWidth / 4;
-		dst += (borderWidth - gbWidth) / 2;
-	}
-	
 	for (h = 0; h < gbHeight; h += 4)
 	{
 		for (w = 0; w < vwid2; ++w)
@@ -694,7 +814,6 @@ void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
 		src2 += srcrowpitch;
 		src3 += srcrowpitch;
 		src4 += srcrowpitch;
-		dst += dstrowpitch;
 
 		if ( srcrowadjust )
 		{
@@ -708,21 +827,103 @@ void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
 			src4 = (long long int *)(ra + srcrowadjust);
 		}
 	}
+}
+
+/****************************************************************************
+* GX_Render
+*
+* Pass in a buffer, width and height to update as a tiled RGB565 texture
+* (2 bytes per pixel). The buffer is only read when the core is not writing
+* the texture directly. When the core wrote the same frame again, the last
+* frame is left on screen.
+****************************************************************************/
+void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
+{
+	bool cursor = false;
+
+	// Ensure previous vb has complete
+	while ((LWP_ThreadIsSuspended (vbthread) == 0) || (copynow == GX_TRUE))
+		usleep (50);
+
+	#ifdef HW_RVL
+	cursor = CursorVisible && CursorValid;
+	#endif
+
+	if (systemTiledScreen && !systemScreenChanged && !updateScaling &&
+		!ScreenshotRequested && !TiltScreen && !cursor && !cursorDrawn &&
+		!blendPending)
+	{
+		// still pace the emulator to the next vb
+		LWP_ResumeThread (vbthread);
+		return;
+	}
+
+	// a changed frame blended with the last one needs to be shown once more
+	// unblended, even if the next frame is the same
+	blendPending = GCSettings.frameblend && systemScreenChanged;
+	systemScreenChanged = false;
+	cursorDrawn = cursor;
+	whichfb ^= 1;
+
+	if(updateScaling)
+		UpdateScaling();
+
+	// clear texture objects
+	GX_InvVtxCache();
+	GX_InvalidateTexAll();
+	GX_SetTevOp(GX_TEVSTAGE0, GX_DECAL);
+	GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+	
+	if (gbWidth == 256 && gbHeight == 224 && !SGBBorderLoadedFromGame) {
+		if (borderAreaEmpty((u16*)buffer)) {
+			// TODO: don't paint empty SGB border
+		} else {
+			// don't try to load the default border anymore
+			SGBBorderLoadedFromGame = true;
+			SaveSGBBorderIfNoneExists(buffer);
+		}
+	}
+
+	if (!systemTiledScreen)
+		CopyToTexture(gbWidth, gbHeight, buffer);
 	
 	// load texture into GX
 	DCFlushRange(texturemem, texturesize);
 
+	// with nothing to blend with yet, blend with this frame
+	if (GCSettings.frameblend && !blendValid)
+	{
+		memcpy(blendmem, texturemem, texturesize);
+		DCFlushRange(blendmem, texturesize);
+	}
+
 	GX_SetNumChans(1);
 	GX_SetZMode(GX_TRUE, GX_LEQUAL, GX_TRUE);
 	GX_SetColorUpdate(GX_TRUE);
-	GX_LoadTexObj(&texobj, GX_TEXMAP0);
 
-	draw_square(view); // render textured quad
+	if (bordermem)
+	{
+		GX_LoadTexObj(&bordertexobj, GX_TEXMAP0);
+		draw_square(view, 1, 1); // render border
+	}
+
+	GX_LoadTexObj(&texobj, GX_TEXMAP0);
+	SetupPostFilter();
+	draw_square(view, (f32) texwidth / vwidth, (f32) texheight / vheight); // render textured quad, centred in the border
+	ResetPostFilter();
 	#ifdef HW_RVL
 	draw_cursor(view); // render cursor
 	#endif
 	GX_DrawDone();
 
+	// GX is done with the last frame, so keep this one to blend the next with
+	blendValid = GCSettings.frameblend;
+	if (blendValid)
+	{
+		memcpy(blendmem, texturemem, texturesize);
+		DCFlushRange(blendmem, texturesize);
+	}
+
 	if(ScreenshotRequested)
 	{
 		ScreenshotRequested = 0;
@@ -740,33 +941,111 @@ void GX_Render(int gbWidth, int gbHeight, u8 * buffer)
 }
 
 /****************************************************************************
- * TakeScreenshot
+ * screenshotcallback
  *
- * Copies the current screen into a GX texture
+ * Encodes the captured screen to PNG, away from the emulation and GUI
  ***************************************************************************/
-void TakeScreenshot()
+static void *
+screenshotcallback (void *arg)
 {
-	IMGCTX pngContext = PNGU_SelectImageFromBuffer(savebuffer);
+	IMGCTX pngContext = PNGU_SelectImageFromBuffer(gameScreenPng);
 
 	if (pngContext != NULL)
 	{
-		gameScreenPngSize = PNGU_EncodeFromEFB(pngContext, vmode->fbWidth, vmode->efbHeight);
+		int size = PNGU_EncodeFromGXTexture(pngContext, vmode->fbWidth, vmode->efbHeight, encodetexmem, 0);
 		PNGU_ReleaseImageContext(pngContext);
-		gameScreenPng = (u8 *)malloc(gameScreenPngSize);
-		memcpy(gameScreenPng, savebuffer, gameScreenPngSize);
+
+		if (size > 0)
+		{
+			// give back what the worst case allowance didn't use
+			u8 * png = (u8 *) realloc(gameScreenPng, size);
+			if (png)
+				gameScreenPng = png;
+			gameScreenPngSize = size;
+		}
 	}
+
+	free(encodetexmem);
+	encodetexmem = NULL;
+	return NULL;
 }
 
-void ClearScreenshot()
+/****************************************************************************
+ * WaitScreenshot
+ *
+ * Waits until gameScreenPng holds the last screenshot taken
+ ***************************************************************************/
+void WaitScreenshot()
 {
-	if(gameScreenPng)
+	if (screenshotthread != LWP_THREAD_NULL)
 	{
-		gameScreenPngSize = 0;
-		free(gameScreenPng);
-		gameScreenPng = NULL;
+		LWP_JoinThread(screenshotthread, NULL);
+		screenshotthread = LWP_THREAD_NULL;
 	}
 }
 
+/****************************************************************************
+ * TakeScreenshot
+ *
+ * Copies the current screen into gameScreenTex, and starts encoding it to
+ * gameScreenPng in the background
+ ***************************************************************************/
+void TakeScreenshot()
+{
+	int width = vmode->fbWidth;
+	int height = vmode->efbHeight;
+	int size = width * height * 4;
+
+	ClearScreenshot();
+
+	if (screentexsize != size)
+	{
+		free(screentexmem);
+		screentexmem = (u8 *) memalign(32, size);
+		screentexsize = screentexmem ? size : 0;
+	}
+
+	encodetexmem = (u8 *) memalign(32, size);
+	// room for an uncompressible image
+	gameScreenPng = (u8 *) malloc(width * height * 3 + height + 65536);
+
+	if (!screentexmem || !encodetexmem || !gameScreenPng)
+	{
+		ClearScreenshot();
+		return;
+	}
+
+	// the GPU copies the EFB twice, so the menu may change its copy while
+	// the other is being encoded
+	GX_SetTexCopySrc(0, 0, width, height);
+	GX_SetTexCopyDst(width, height, GX_TF_RGBA8, GX_FALSE);
+	DCInvalidateRange(screentexmem, size);
+	DCInvalidateRange(encodetexmem, size);
+	GX_CopyTex(screentexmem, GX_FALSE);
+	GX_CopyTex(encodetexmem, GX_FALSE);
+	GX_PixModeSync();
+	GX_DrawDone(); // the copies must have landed before the CPU reads them
+
+	gameScreenTex = screentexmem;
+
+	if (LWP_CreateThread(&screenshotthread, screenshotcallback, NULL, NULL, 0, 40) < 0)
+	{
+		screenshotthread = LWP_THREAD_NULL;
+		screenshotcallback(NULL);
+	}
+}
+
+void ClearScreenshot()
+{
+	WaitScreenshot();
+
+	free(encodetexmem);
+	free(gameScreenPng);
+	encodetexmem = gameScreenPng = NULL;
+	gameScreenTex = NULL;
+	gameScreenPngSize = 0;
+}
+
 /****************************************************************************
  * ResetVideo_Menu
  *
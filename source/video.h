@@ -14,13 +14,21 @@
 
 #include <ogcsys.h>
 
+enum {
+	POSTFILTER_NONE,
+	POSTFILTER_LCD_GRID,
+	POSTFILTER_SCANLINES,
+	POSTFILTER_LENGTH
+};
+
 void InitializeVideo ();
-void GX_Render_Init(int width, int height);
+void GX_Render_Init(int width, int height, bool tiled);
 void GX_Render(int gbWidth, int gbHeight, u8 * buffer);
 void StopGX();
 void ResetVideo_Emu();
 void ResetVideo_Menu();
 void TakeScreenshot();
+void WaitScreenshot();
 void ClearScreenshot();
 void Menu_Render();
 void Menu_DrawImg(f32 xpos, f32 ypos, u16 width, u16 height, u8 data[], f32 degrees, f32 scaleX, f32 scaleY, u8 alphaF );